@@ -1,546 +1,3478 @@
 #include "big_integer.h"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <iostream>
-#include <array>
+#include <memory>
+#include <mutex>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+typedef big_integer::limb limb;
+#if BIG_INTEGER_LIMB_BITS == 64
+__extension__ typedef unsigned __int128 double_limb;
+#else
+typedef uint64_t double_limb;
+#endif
+
+constexpr static const limb LIMB_BITS = BIG_INTEGER_LIMB_BITS;
+constexpr static const limb LIMB_MAX = ~limb(0);
+constexpr static const limb HIGHEST_BIT = limb(1) << (LIMB_BITS - 1);
+constexpr static const size_t KARATSUBA_THRESHOLD = 32;
+constexpr static const size_t TOOM3_THRESHOLD = 3000;
+// the NTT covers products up to NTT_MAX_SIZE 32-bit words, Toom-Cook takes over above that
+// and splits in four once its pieces would need the largest transform if split in three
+constexpr static const size_t TOOM4_THRESHOLD = (size_t(3) << 21) / (LIMB_BITS / 32);
+constexpr static const size_t NTT_THRESHOLD = LIMB_BITS == 64 ? 16000 : 6000;
+constexpr static const size_t BURNIKEL_ZIEGLER_THRESHOLD = 80;
+constexpr static const size_t BARRETT_THRESHOLD = 40;
+constexpr static const size_t REDC_THRESHOLD = LIMB_BITS == 64 ? 192 : 256;
+constexpr static const size_t HGCD_THRESHOLD = 250;
+constexpr static const size_t GCD_HGCD_THRESHOLD = 2000;
+constexpr static const size_t PARSE_THRESHOLD = 1000; // digits
+constexpr static const size_t FORMAT_THRESHOLD = 30;
+constexpr static const size_t RADIX_CACHE_LIMIT = size_t(64) << 20; // bytes
+
+limb get_low(double_limb num) {
+    return static_cast<limb>(num);
+}
+
+limb get_high(double_limb num) {
+    return static_cast<limb>(num >> LIMB_BITS);
+}
+
+double_limb set_high(limb num) {
+    return static_cast<double_limb>(num) << LIMB_BITS;
+}
+
+bool get_highest_bit(limb number) {
+    return number & HIGHEST_BIT;
+}
+
+limb leading_zeros(limb number) {
+    return __builtin_clzll(number) - (64 - LIMB_BITS);
+}
+
+namespace {
+    // Kernels below work on unsigned magnitudes stored as raw little-endian limb spans,
+    // B = 2^LIMB_BITS is the limb base.
+
+    limb add_n(limb* r, limb const* a, limb const* b, size_t n) {
+        double_limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb sum = static_cast<double_limb>(a[i]) + b[i] + carry;
+            r[i] = get_low(sum);
+            carry = get_high(sum);
+        }
+        return static_cast<limb>(carry);
+    }
+
+    limb sub_n(limb* r, limb const* a, limb const* b, size_t n) {
+        limb borrow = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb cur = static_cast<double_limb>(a[i]) - b[i] - borrow;
+            r[i] = get_low(cur);
+            borrow = get_high(cur) != 0;
+        }
+        return borrow;
+    }
+
+    // r[0..n) -= a[0..m), m <= n, returns the borrow out of r[n - 1]
+    limb sub_in(limb* r, size_t n, limb const* a, size_t m) {
+        limb borrow = sub_n(r, r, a, m);
+        for (size_t i = m; i < n && borrow; ++i) {
+            borrow = (r[i]-- == 0);
+        }
+        return borrow;
+    }
+
+    // r[0..n) += a[0..m), m <= n, returns the carry out of r[n - 1]
+    limb add_in(limb* r, size_t n, limb const* a, size_t m) {
+        limb carry = add_n(r, r, a, m);
+        for (size_t i = m; i < n && carry; ++i) {
+            carry = (++r[i] == 0);
+        }
+        return carry;
+    }
+
+    int compare_n(limb const* a, limb const* b, size_t n) {
+        for (size_t i = n; i-- > 0;) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // compares magnitudes without high zero limbs
+    int compare_magnitudes(limb const* a, size_t an, limb const* b, size_t bn) {
+        if (an != bn) {
+            return an < bn ? -1 : 1;
+        }
+        return compare_n(a, b, an);
+    }
+
+    // r[0..n) = -r[0..n) modulo B^n: low zero limbs stay, the first nonzero one is negated
+    // and the ones above it are inverted
+    void negate_n(limb* r, size_t n) {
+        size_t i = 0;
+        while (i < n && r[i] == 0) {
+            ++i;
+        }
+        if (i < n) {
+            r[i] = 0 - r[i];
+            ++i;
+        }
+        for (; i < n; ++i) {
+            r[i] = ~r[i];
+        }
+    }
+
+    // r[0..an + bn) = a * b
+    void mul_basecase(limb* r, limb const* a, size_t an, limb const* b, size_t bn) {
+        std::fill(r, r + an + bn, 0);
+        for (size_t i = 0; i != an; ++i) {
+            double_limb carry = 0;
+            for (size_t j = 0; j != bn; ++j) {
+                double_limb t = static_cast<double_limb>(a[i]) * b[j] + r[i + j] + carry;
+                r[i + j] = get_low(t);
+                carry = get_high(t);
+            }
+            r[i + bn] = static_cast<limb>(carry);
+        }
+    }
+
+    // r[0..2n) = a[0..n)^2, each cross product a[i] * a[j] is computed once and doubled
+    void sqr_basecase(limb* r, limb const* a, size_t n) {
+        std::fill(r, r + 2 * n, 0);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            double_limb carry = 0;
+            for (size_t j = i + 1; j < n; ++j) {
+                double_limb t = static_cast<double_limb>(a[i]) * a[j] + r[i + j] + carry;
+                r[i + j] = get_low(t);
+                carry = get_high(t);
+            }
+            r[i + n] = static_cast<limb>(carry);
+        }
+        limb shifted = 0;
+        for (size_t i = 0; i < 2 * n; ++i) {
+            limb next = r[i] >> (LIMB_BITS - 1);
+            r[i] = (r[i] << 1) | shifted;
+            shifted = next;
+        }
+        double_limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb sq = static_cast<double_limb>(a[i]) * a[i];
+            double_limb low = static_cast<double_limb>(r[2 * i]) + get_low(sq) + carry;
+            double_limb high = static_cast<double_limb>(r[2 * i + 1]) + get_high(sq) + get_high(low);
+            r[2 * i] = get_low(low);
+            r[2 * i + 1] = get_low(high);
+            carry = get_high(high);
+        }
+    }
+
+    // d[0..hi) = |x[lo..lo + hi) - x[0..lo)|, returns whether the difference is negative
+    bool abs_diff_halves(limb* d, limb const* x, size_t lo, size_t hi) {
+        bool top = hi != lo && x[2 * lo] != 0;
+        if (!top && compare_n(x + lo, x, lo) < 0) {
+            sub_n(d, x, x + lo, lo);
+            if (hi != lo) {
+                d[lo] = 0;
+            }
+            return true;
+        }
+        limb borrow = sub_n(d, x + lo, x, lo);
+        if (hi != lo) {
+            d[lo] = x[2 * lo] - borrow;
+        }
+        return false;
+    }
+
+    size_t karatsuba_scratch_size(size_t n) {
+        if (n < KARATSUBA_THRESHOLD) {
+            return 0;
+        }
+        size_t hi = n - n / 2;
+        return 6 * hi + 1 + karatsuba_scratch_size(hi);
+    }
+
+    // r[0..2n) = a[0..n) * b[0..n), scratch holds karatsuba_scratch_size(n) limbs
+    void mul_karatsuba(limb* r, limb const* a, limb const* b, size_t n, limb* scratch) {
+        if (n < KARATSUBA_THRESHOLD) {
+            mul_basecase(r, a, n, b, n);
+            return;
+        }
+        size_t lo = n / 2;
+        size_t hi = n - lo;
+        limb* da = scratch;
+        limb* db = da + hi;
+        limb* mid = db + hi;
+        limb* sum = mid + 2 * hi;
+        limb* next = sum + 2 * hi + 1;
+
+        bool negative = abs_diff_halves(da, a, lo, hi) ^ abs_diff_halves(db, b, lo, hi);
+
+        mul_karatsuba(r, a, b, lo, next);
+        mul_karatsuba(r + 2 * lo, a + lo, b + lo, hi, next);
+        mul_karatsuba(mid, da, db, hi, next);
+
+        // sum = a0 * b0 + a1 * b1 -/+ |a1 - a0| * |b1 - b0|
+        std::copy(r + 2 * lo, r + 2 * n, sum);
+        sum[2 * hi] = add_in(sum, 2 * hi, r, 2 * lo);
+        if (negative) {
+            sum[2 * hi] += add_n(sum, sum, mid, 2 * hi);
+        } else {
+            sum[2 * hi] -= sub_n(sum, sum, mid, 2 * hi);
+        }
+        add_in(r + lo, 2 * n - lo, sum, 2 * hi + 1);
+    }
+
+    // r[0..2n) = a[0..n)^2, scratch holds karatsuba_scratch_size(n) limbs
+    void sqr_karatsuba(limb* r, limb const* a, size_t n, limb* scratch) {
+        if (n < KARATSUBA_THRESHOLD) {
+            sqr_basecase(r, a, n);
+            return;
+        }
+        size_t lo = n / 2;
+        size_t hi = n - lo;
+        limb* da = scratch;
+        limb* mid = da + hi;
+        limb* sum = mid + 2 * hi;
+        limb* next = sum + 2 * hi + 1;
+
+        abs_diff_halves(da, a, lo, hi);
+
+        sqr_karatsuba(r, a, lo, next);
+        sqr_karatsuba(r + 2 * lo, a + lo, hi, next);
+        sqr_karatsuba(mid, da, hi, next);
+
+        // sum = a0^2 + a1^2 - (a1 - a0)^2
+        std::copy(r + 2 * lo, r + 2 * n, sum);
+        sum[2 * hi] = add_in(sum, 2 * hi, r, 2 * lo);
+        sum[2 * hi] -= sub_n(sum, sum, mid, 2 * hi);
+        add_in(r + lo, 2 * n - lo, sum, 2 * hi + 1);
+    }
+
+    limb mul_add_1(limb* r, size_t n, limb m, limb c);
+    size_t mul_scratch_size(size_t n);
+    void mul_balanced(limb* r, limb const* a, limb const* b, size_t n, limb* scratch);
+    void sqr_balanced(limb* r, limb const* a, size_t n, limb* scratch);
+
+    // signed value of Toom-Cook evaluation and interpolation: w limbs of magnitude in the
+    // scratch of mul_toom, wide enough that nothing is carried out of them
+    struct toom_value {
+        limb* mag;
+        size_t w;
+        bool negative;
+
+        void assign(limb const* a, size_t n) {
+            std::copy(a, a + n, mag);
+            std::fill(mag + n, mag + w, 0);
+            negative = false;
+        }
+
+        void assign(toom_value const& rhs) {
+            std::copy(rhs.mag, rhs.mag + w, mag);
+            negative = rhs.negative;
+        }
+
+        // this += a[0..n) with the given sign, n <= w
+        toom_value& add(limb const* a, size_t n, bool a_negative) {
+            if (negative == a_negative) {
+                add_in(mag, w, a, n);
+                return *this;
+            }
+            bool smaller = std::all_of(mag + n, mag + w, [](limb x) { return x == 0; }) && compare_n(mag, a, n) < 0;
+            sub_in(mag, w, a, n);
+            if (smaller) {
+                negate_n(mag, w);
+                negative = a_negative;
+            }
+            return *this;
+        }
+
+        toom_value& add(toom_value const& rhs, bool subtract) {
+            return add(rhs.mag, rhs.w, rhs.negative ^ subtract);
+        }
+
+        toom_value& mul_small(int64_t m) {
+            mul_add_1(mag, w, static_cast<limb>(m < 0 ? -m : m), 0);
+            negative ^= m < 0;
+            return *this;
+        }
+
+        toom_value& div_exact_small(int64_t d) {
+            double_limb divider = static_cast<double_limb>(d < 0 ? -d : d);
+            double_limb carry = 0;
+            for (size_t i = w; i-- > 0;) {
+                double_limb cur = set_high(static_cast<limb>(carry)) | mag[i];
+                mag[i] = get_low(cur / divider);
+                carry = cur % divider;
+            }
+            negative ^= d < 0;
+            return *this;
+        }
+    };
+
+    size_t toom_parts(size_t n) {
+        return n < TOOM4_THRESHOLD ? 3 : 4;
+    }
+
+    // 2k slots of 2 len + 4 limbs for the 2k - 2 point values and the two evaluated operands,
+    // then the scratch of the products
+    size_t toom_scratch_size(size_t n) {
+        size_t k = toom_parts(n);
+        size_t len = (n + k - 1) / k;
+        size_t last = n - (k - 1) * len;
+        return 2 * k * (2 * len + 4) + std::max(mul_scratch_size(len + 1), mul_scratch_size(last));
+    }
+
+    // value of the polynomial with the k parts of a[0..n) as coefficients at a small point
+    void toom_evaluate(toom_value& result, limb const* a, size_t n, size_t k, size_t len, int64_t point) {
+        result.assign(a + (k - 1) * len, n - (k - 1) * len);
+        for (size_t i = k - 1; i-- > 0;) {
+            result.mul_small(point).add(a + i * len, len, false);
+        }
+    }
+
+    // r[0..2n) = a[0..n) * b[0..n) split into 3 or 4 parts, scratch holds toom_scratch_size(n)
+    // limbs. The product polynomial is evaluated at 0, 1, -1, 2, -2, ... and infinity, then
+    // interpolated with Newton divided differences, which are exact integers for polynomials
+    // with integer coefficients. When a and b are the same span only one operand is evaluated
+    // and every point value is squared.
+    void mul_toom(limb* r, limb const* a, limb const* b, size_t n, limb* scratch) {
+        bool square = a == b;
+        size_t k = toom_parts(n);
+        size_t len = (n + k - 1) / k;
+        size_t last = n - (k - 1) * len;
+        size_t m = 2 * k - 2;
+        size_t w = 2 * len + 4;
+        int64_t points[6];
+        toom_value values[6];
+        for (size_t i = 0; i < m; ++i) {
+            points[i] = (i % 2 == 1) ? static_cast<int64_t>(i / 2 + 1) : -static_cast<int64_t>(i / 2);
+            values[i] = toom_value{scratch + i * w, w, false};
+        }
+        toom_value ea{scratch + m * w, w, false};
+        toom_value eb{scratch + (m + 1) * w, w, false};
+        limb* next = scratch + (m + 2) * w;
+
+        // the leading coefficient goes straight to the top of r
+        limb* infinity = r + m * len;
+        if (square) {
+            sqr_balanced(infinity, a + (k - 1) * len, last, next);
+        } else {
+            mul_balanced(infinity, a + (k - 1) * len, b + (k - 1) * len, last, next);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            toom_evaluate(ea, a, n, k, len, points[i]);
+            if (square) {
+                sqr_balanced(values[i].mag, ea.mag, len + 1, next);
+            } else {
+                toom_evaluate(eb, b, n, k, len, points[i]);
+                mul_balanced(values[i].mag, ea.mag, eb.mag, len + 1, next);
+                values[i].negative = ea.negative ^ eb.negative;
+            }
+            std::fill(values[i].mag + 2 * len + 2, values[i].mag + w, 0);
+            if (points[i] != 0) {
+                int64_t power = 1;
+                for (size_t j = 0; j < m; ++j) {
+                    power *= points[i];
+                }
+                ea.assign(infinity, 2 * last);
+                values[i].add(ea.mul_small(power), true);
+            }
+        }
+        for (size_t j = 1; j < m; ++j) {
+            for (size_t i = m - 1; i >= j; --i) {
+                values[i].add(values[i - 1], true).div_exact_small(points[i] - points[i - j]);
+            }
+        }
+        // expand the Newton form into monomial coefficients in place, x_0 = 0 needs no step
+        for (size_t i = m - 1; i-- > 1;) {
+            for (size_t j = i; j + 1 < m; ++j) {
+                ea.assign(values[j + 1]);
+                values[j].add(ea.mul_small(points[i]), true);
+            }
+        }
+        std::fill(r, infinity, 0);
+        for (size_t i = 0; i < m; ++i) {
+            size_t size = std::min(w, 2 * n - i * len);
+            while (size > 0 && values[i].mag[size - 1] == 0) {
+                --size;
+            }
+            add_in(r + i * len, 2 * n - i * len, values[i].mag, size);
+        }
+    }
+
+    // Limbs are transformed directly. A convolution term is a sum of at most 2^22 products
+    // below 2^64, which stays below the product of the three primes (about 2^86); 2^23 is the
+    // largest power of two dividing 998244353 - 1.
+    constexpr static const size_t NTT_MAX_SIZE = size_t(1) << 23;
+    constexpr static const uint32_t NTT_MOD1 = 998244353;
+    constexpr static const uint32_t NTT_MOD2 = 167772161;
+    constexpr static const uint32_t NTT_MOD3 = 469762049;
+    constexpr static const uint32_t NTT_ROOT = 3; // primitive root of all three primes
+
+    uint32_t pow_mod(uint64_t base, uint64_t exp, uint32_t mod) {
+        uint64_t result = 1;
+        base %= mod;
+        for (; exp != 0; exp >>= 1) {
+            if (exp & 1) {
+                result = result * base % mod;
+            }
+            base = base * base % mod;
+        }
+        return static_cast<uint32_t>(result);
+    }
+
+    // Montgomery arithmetic modulo an NTT prime below 2^30 with R = 2^32
+    template <uint32_t MOD>
+    struct montgomery {
+        static constexpr uint32_t neg_inverse() {
+            uint32_t inv = MOD;
+            for (int i = 0; i < 5; ++i) {
+                inv *= 2 - MOD * inv;
+            }
+            return -inv;
+        }
+
+        static uint32_t reduce(uint64_t t) {
+            constexpr uint32_t neg_inv = neg_inverse();
+            uint32_t m = static_cast<uint32_t>(t) * neg_inv;
+            uint32_t u = static_cast<uint32_t>((t + static_cast<uint64_t>(m) * MOD) >> 32);
+            return u >= MOD ? u - MOD : u;
+        }
+
+        // a * b / R mod MOD
+        static uint32_t mul(uint32_t a, uint32_t b) {
+            return reduce(static_cast<uint64_t>(a) * b);
+        }
+
+        // a * R mod MOD
+        static uint32_t to_form(uint64_t a) {
+            return static_cast<uint32_t>((a % MOD << 32) % MOD);
+        }
+    };
+
+    // powers of a primitive len-th root of unity (or of its inverse) in Montgomery form
+    template <uint32_t MOD>
+    void fill_roots(std::vector<uint32_t>& roots, size_t len, bool invert) {
+        using mont = montgomery<MOD>;
+        uint32_t w = pow_mod(NTT_ROOT, (MOD - 1) / len, MOD);
+        if (invert) {
+            w = pow_mod(w, MOD - 2, MOD);
+        }
+        uint32_t w_form = mont::to_form(w);
+        roots[0] = mont::to_form(1);
+        for (size_t i = 1; i < len / 2; ++i) {
+            roots[i] = mont::mul(roots[i - 1], w_form);
+        }
+    }
+
+    // The forward transform is decimation-in-frequency and leaves the spectrum in bit-reversed
+    // order, the inverse one is decimation-in-time and takes it back, so convolution never
+    // permutes. Values are kept in plain form and twiddles in Montgomery form, so a butterfly
+    // costs one Montgomery multiplication; the inverse transform also removes the factor
+    // R^-1 left by the pointwise products.
+    template <uint32_t MOD>
+    void ntt(std::vector<uint32_t>& a, bool invert) {
+        using mont = montgomery<MOD>;
+        size_t n = a.size();
+        std::vector<uint32_t> roots(n / 2 + 1);
+        for (size_t step = 1; step < n; step <<= 1) {
+            size_t len = invert ? 2 * step : n / step;
+            fill_roots<MOD>(roots, len, invert);
+            for (size_t i = 0; i < n; i += len) {
+                uint32_t* lo = a.data() + i;
+                uint32_t* hi = lo + len / 2;
+                for (size_t j = 0; j < len / 2; ++j) {
+                    uint32_t u = lo[j];
+                    if (invert) {
+                        uint32_t v = mont::mul(hi[j], roots[j]);
+                        lo[j] = u + v < MOD ? u + v : u + v - MOD;
+                        hi[j] = u >= v ? u - v : u + MOD - v;
+                    } else {
+                        uint32_t v = hi[j];
+                        lo[j] = u + v < MOD ? u + v : u + v - MOD;
+                        hi[j] = mont::mul(u >= v ? u - v : u + MOD - v, roots[j]);
+                    }
+                }
+            }
+        }
+        if (invert) {
+            uint32_t scale = mont::to_form(mont::to_form(pow_mod(n, MOD - 2, MOD)));
+            for (uint32_t& x : a) {
+                x = mont::mul(x, scale);
+            }
+        }
+    }
+
+    // cyclic convolution of a and b modulo MOD with the given transform size,
+    // a single forward transform is done when a and b are the same span
+    template <uint32_t MOD>
+    std::vector<uint32_t> convolve(uint32_t const* a, size_t an, uint32_t const* b, size_t bn, size_t size) {
+        std::vector<uint32_t> fa(size, 0);
+        for (size_t i = 0; i < an; ++i) {
+            fa[i] = a[i] % MOD;
+        }
+        ntt<MOD>(fa, false);
+        if (a == b) {
+            for (uint32_t& x : fa) {
+                x = montgomery<MOD>::mul(x, x);
+            }
+        } else {
+            std::vector<uint32_t> fb(size, 0);
+            for (size_t i = 0; i < bn; ++i) {
+                fb[i] = b[i] % MOD;
+            }
+            ntt<MOD>(fb, false);
+            for (size_t i = 0; i < size; ++i) {
+                fa[i] = montgomery<MOD>::mul(fa[i], fb[i]);
+            }
+        }
+        ntt<MOD>(fa, true);
+        return fa;
+    }
+
+    // r[0..an + bn) = a * b via convolution modulo three NTT primes and CRT recombination,
+    // requires an + bn <= NTT_MAX_SIZE
+    void mul_ntt(uint32_t* r, uint32_t const* a, size_t an, uint32_t const* b, size_t bn) {
+        size_t size = 1;
+        while (size < an + bn) {
+            size <<= 1;
+        }
+        std::vector<uint32_t> r1 = convolve<NTT_MOD1>(a, an, b, bn, size);
+        std::vector<uint32_t> r2 = convolve<NTT_MOD2>(a, an, b, bn, size);
+        std::vector<uint32_t> r3 = convolve<NTT_MOD3>(a, an, b, bn, size);
+        constexpr uint64_t p1 = NTT_MOD1;
+        constexpr uint64_t p2 = NTT_MOD2;
+        constexpr uint64_t p3 = NTT_MOD3;
+        uint64_t const p1_inv_p2 = pow_mod(p1, p2 - 2, NTT_MOD2);
+        uint64_t const p12_inv_p3 = pow_mod(p1 * p2 % p3, p3 - 2, NTT_MOD3);
+        constexpr uint64_t p12 = p1 * p2; // below 2^58
+        // v1 + v2 p1 + v3 p1 p2 is added in 32-bit columns, so that no product exceeds 64 bits;
+        // the carry, below 2^56, is kept as its low and high 32-bit words
+        uint64_t carry_low = 0;
+        uint64_t carry_high = 0;
+        for (size_t i = 0; i < an + bn; ++i) {
+            uint64_t v1 = r1[i];
+            uint64_t v2 = (r2[i] + p2 - v1 % p2) * p1_inv_p2 % p2;
+            uint64_t v3 = (r3[i] + p3 - (v1 + v2 * p1) % p3) * p12_inv_p3 % p3;
+            uint64_t low = v1 + v2 * p1;
+            uint64_t mid = v3 * (p12 & 0xffffffff);
+            uint64_t high = v3 * (p12 >> 32);
+            uint64_t column0 = carry_low + (low & 0xffffffff) + (mid & 0xffffffff);
+            uint64_t column1 = carry_high + (low >> 32) + (mid >> 32) + (high & 0xffffffff) + (column0 >> 32);
+            r[i] = static_cast<uint32_t>(column0);
+            carry_low = column1 & 0xffffffff;
+            carry_high = (high >> 32) + (column1 >> 32);
+        }
+    }
+
+#if BIG_INTEGER_LIMB_BITS == 64
+    // 64-bit limbs are transformed as pairs of 32-bit halves, which keeps the same bound
+    // on the convolution terms
+    std::vector<uint32_t> split_halves(limb const* a, size_t n) {
+        std::vector<uint32_t> result(2 * n);
+        for (size_t i = 0; i < n; ++i) {
+            result[2 * i] = static_cast<uint32_t>(a[i]);
+            result[2 * i + 1] = static_cast<uint32_t>(a[i] >> 32);
+        }
+        return result;
+    }
+
+    void mul_ntt(limb* r, limb const* a, size_t an, limb const* b, size_t bn) {
+        std::vector<uint32_t> a32 = split_halves(a, an);
+        std::vector<uint32_t> b32 = a == b ? std::vector<uint32_t>() : split_halves(b, bn);
+        uint32_t const* b_data = a == b ? a32.data() : b32.data();
+        std::vector<uint32_t> r32(2 * (an + bn));
+        mul_ntt(r32.data(), a32.data(), 2 * an, b_data, 2 * bn);
+        for (size_t i = 0; i < an + bn; ++i) {
+            r[i] = static_cast<limb>(r32[2 * i]) | static_cast<limb>(r32[2 * i + 1]) << 32;
+        }
+    }
+#endif
+
+    bool use_ntt(size_t an, size_t bn) {
+        return std::min(an, bn) >= NTT_THRESHOLD && (an + bn) * (LIMB_BITS / 32) <= NTT_MAX_SIZE;
+    }
+
+    // scratch of mul_balanced and sqr_balanced for n limbs
+    size_t mul_scratch_size(size_t n) {
+        if (use_ntt(n, n)) {
+            return 0;
+        }
+        return n < TOOM3_THRESHOLD ? karatsuba_scratch_size(n) : toom_scratch_size(n);
+    }
+
+    // r[0..2n) = a[0..n) * b[0..n), scratch holds mul_scratch_size(n) limbs
+    void mul_balanced(limb* r, limb const* a, limb const* b, size_t n, limb* scratch) {
+        if (use_ntt(n, n)) {
+            mul_ntt(r, a, n, b, n);
+        } else if (n < TOOM3_THRESHOLD) {
+            mul_karatsuba(r, a, b, n, scratch);
+        } else {
+            mul_toom(r, a, b, n, scratch);
+        }
+    }
+
+    // r[0..2n) = a[0..n)^2, scratch holds mul_scratch_size(n) limbs
+    void sqr_balanced(limb* r, limb const* a, size_t n, limb* scratch) {
+        if (use_ntt(n, n)) {
+            mul_ntt(r, a, n, a, n);
+        } else if (n < TOOM3_THRESHOLD) {
+            sqr_karatsuba(r, a, n, scratch);
+        } else {
+            mul_toom(r, a, a, n, scratch);
+        }
+    }
+
+    // r[0..2n) = a[0..n)^2
+    void sqr_unsigned(limb* r, limb const* a, size_t n) {
+        if (n < KARATSUBA_THRESHOLD) {
+            sqr_basecase(r, a, n);
+            return;
+        }
+        std::vector<limb> scratch(mul_scratch_size(n));
+        sqr_balanced(r, a, n, scratch.data());
+    }
+
+    // r[0..an + bn) = a * b for arbitrary operand lengths
+    void mul_unsigned(limb* r, limb const* a, size_t an, limb const* b, size_t bn) {
+        if (a == b && an == bn) {
+            sqr_unsigned(r, a, an);
+            return;
+        }
+        if (an < bn) {
+            std::swap(a, b);
+            std::swap(an, bn);
+        }
+        if (bn < KARATSUBA_THRESHOLD) {
+            mul_basecase(r, a, an, b, bn);
+            return;
+        }
+        if (use_ntt(an, bn)) {
+            mul_ntt(r, a, an, b, bn);
+            return;
+        }
+        std::vector<limb> scratch(mul_scratch_size(bn));
+        if (an == bn) {
+            mul_balanced(r, a, b, bn, scratch.data());
+            return;
+        }
+        // split the longer operand into bn-sized blocks and accumulate the partial products
+        std::vector<limb> part(2 * bn);
+        std::fill(r, r + an + bn, 0);
+        size_t i = 0;
+        for (; i + bn <= an; i += bn) {
+            mul_balanced(part.data(), a + i, b, bn, scratch.data());
+            add_in(r + i, an + bn - i, part.data(), 2 * bn);
+        }
+        if (i < an) {
+            mul_unsigned(part.data(), b, bn, a + i, an - i);
+            add_in(r + i, an + bn - i, part.data(), an - i + bn);
+        }
+    }
+
+    // number of limbs without high zero limbs, at least one
+    template <typename Digits>
+    size_t significant_length(Digits const& digits) {
+        size_t n = digits.size();
+        while (n > 1 && digits[n - 1] == 0) {
+            --n;
+        }
+        return n;
+    }
+
+    // r[0..n) = r[0..n) * m + c, returns the carry out of r[n - 1]
+    limb mul_add_1(limb* r, size_t n, limb m, limb c) {
+        double_limb carry = c;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb cur = static_cast<double_limb>(r[i]) * m + carry;
+            r[i] = get_low(cur);
+            carry = get_high(cur);
+        }
+        return get_low(carry);
+    }
+
+    // r[0..n) += a[0..n) * m, returns the carry into r[n]
+    limb addmul_1(limb* r, limb const* a, size_t n, limb m) {
+        double_limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb cur = static_cast<double_limb>(a[i]) * m + r[i] + carry;
+            r[i] = get_low(cur);
+            carry = get_high(cur);
+        }
+        return static_cast<limb>(carry);
+    }
+
+    // r[0..n) -= a[0..n) * m, returns the limb borrowed from r[n]
+    limb submul_1(limb* r, limb const* a, size_t n, limb m) {
+        double_limb carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            double_limb product = static_cast<double_limb>(a[i]) * m + carry;
+            limb low = get_low(product);
+            carry = get_high(product) + (r[i] < low);
+            r[i] -= low;
+        }
+        return static_cast<limb>(carry);
+    }
+
+    // Knuth's algorithm D: q[0..un - vn] = u / v and u[0..vn) = u % v, where u has un + 1 limbs
+    // with a zero top limb, vn >= 2 and the highest bit of v[vn - 1] is set
+    void div_basecase(limb* q, limb* u, size_t un, limb const* v, size_t vn) {
+        double_limb v_high = v[vn - 1];
+        double_limb v_next = v[vn - 2];
+        for (size_t j = un - vn + 1; j-- > 0;) {
+            double_limb num = set_high(u[j + vn]) | u[j + vn - 1];
+            double_limb q_hat = num / v_high;
+            double_limb r_hat = num % v_high;
+            while (q_hat > LIMB_MAX || q_hat * v_next > (set_high(get_low(r_hat)) | u[j + vn - 2])) {
+                --q_hat;
+                r_hat += v_high;
+                if (r_hat > LIMB_MAX) {
+                    break;
+                }
+            }
+            limb borrow = submul_1(u + j, v, vn, static_cast<limb>(q_hat));
+            if (u[j + vn] < borrow) {
+                --q_hat;
+                u[j + vn] += add_n(u + j, u + j, v, vn);
+            }
+            u[j + vn] -= borrow;
+            q[j] = static_cast<limb>(q_hat);
+        }
+    }
+
+    // Unsigned numbers for the recursive division, stored without high zero limbs
+    // (zero is the empty vector).
+    typedef std::vector<limb> natural;
+
+    void trim_natural(natural& a) {
+        while (!a.empty() && a.back() == 0) {
+            a.pop_back();
+        }
+    }
+
+    int compare_natural(natural const& a, natural const& b) {
+        return compare_magnitudes(a.data(), a.size(), b.data(), b.size());
+    }
+
+    void add_natural(natural& a, natural const& b) {
+        a.resize(std::max(a.size(), b.size()) + 1, 0);
+        add_in(a.data(), a.size(), b.data(), b.size());
+        trim_natural(a);
+    }
+
+    // a -= b, requires a >= b
+    void sub_natural(natural& a, natural const& b) {
+        sub_in(a.data(), a.size(), b.data(), b.size());
+        trim_natural(a);
+    }
+
+    natural mul_natural(natural const& a, natural const& b) {
+        if (a.empty() || b.empty()) {
+            return natural();
+        }
+        natural result(a.size() + b.size());
+        mul_unsigned(result.data(), a.data(), a.size(), b.data(), b.size());
+        trim_natural(result);
+        return result;
+    }
+
+    // limbs [from, from + count) of a
+    natural slice_natural(natural const& a, size_t from, size_t count) {
+        from = std::min(from, a.size());
+        natural result(a.begin() + from, a.begin() + std::min(a.size(), from + count));
+        trim_natural(result);
+        return result;
+    }
+
+    // a * B^limbs + low, low must be shorter than limbs
+    natural join_natural(natural const& a, size_t limbs, natural const& low) {
+        if (a.empty()) {
+            return low;
+        }
+        natural result(limbs, 0);
+        std::copy(low.begin(), low.end(), result.begin());
+        result.insert(result.end(), a.begin(), a.end());
+        return result;
+    }
+
+    natural shift_left_natural(natural const& a, size_t bits) {
+        if (a.empty()) {
+            return a;
+        }
+        size_t limbs = bits / LIMB_BITS;
+        limb r = bits % LIMB_BITS;
+        natural result(limbs + a.size() + 1, 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            double_limb cur = static_cast<double_limb>(a[i]) << r;
+            result[i + limbs] |= get_low(cur);
+            result[i + limbs + 1] = get_high(cur);
+        }
+        trim_natural(result);
+        return result;
+    }
+
+    natural shift_right_natural(natural const& a, size_t bits) {
+        size_t limbs = bits / LIMB_BITS;
+        limb r = bits % LIMB_BITS;
+        if (limbs >= a.size()) {
+            return natural();
+        }
+        natural result(a.size() - limbs);
+        for (size_t i = 0; i < result.size(); ++i) {
+            double_limb cur = static_cast<double_limb>(a[i + limbs]) |
+                           (i + limbs + 1 < a.size() ? set_high(a[i + limbs + 1]) : 0);
+            result[i] = get_low(cur >> r);
+        }
+        trim_natural(result);
+        return result;
+    }
+
+    // q = a / b and r = a % b, the highest bit of b is set
+    void div_natural_basecase(natural const& a, natural const& b, natural& q, natural& r) {
+        if (compare_natural(a, b) < 0) {
+            q.clear();
+            r = a;
+            return;
+        }
+        natural u = a;
+        u.emplace_back(0);
+        q.assign(a.size() - b.size() + 1, 0);
+        if (b.size() == 1) {
+            double_limb carry = 0;
+            for (size_t i = a.size(); i-- > 0;) {
+                double_limb cur = set_high(get_low(carry)) | a[i];
+                q[i] = get_low(cur / b[0]);
+                carry = cur % b[0];
+            }
+            r.assign(1, get_low(carry));
+        } else {
+            div_basecase(q.data(), u.data(), a.size(), b.data(), b.size());
+            r.assign(u.begin(), u.begin() + b.size());
+        }
+        trim_natural(q);
+        trim_natural(r);
+    }
+
+    void div_two_halves(natural const& a, natural const& b, size_t n, natural& q, natural& r);
+
+    // Burnikel-Ziegler step dividing a of at most three halves by b of two halves,
+    // requires a < b * B^half and the highest bit of b set
+    void div_three_halves(natural const& a, natural const& b, size_t half, natural& q, natural& r) {
+        natural b1 = slice_natural(b, half, half);
+        natural b2 = slice_natural(b, 0, half);
+        natural a12 = slice_natural(a, half, 2 * half);
+        if (compare_natural(slice_natural(a, 2 * half, half), b1) < 0) {
+            div_two_halves(a12, b1, half, q, r);
+        } else {
+            // the quotient estimate saturates at B^half - 1
+            q.assign(half, LIMB_MAX);
+            r = a12;
+            add_natural(r, b1);
+            sub_natural(r, join_natural(b1, half, natural()));
+        }
+        natural d = mul_natural(q, b2);
+        r = join_natural(r, half, slice_natural(a, 0, half));
+        natural one(1, 1);
+        while (compare_natural(r, d) < 0) {
+            add_natural(r, b);
+            sub_natural(q, one);
+        }
+        sub_natural(r, d);
+    }
+
+    // Burnikel-Ziegler division of a of at most 2n limbs by b of n limbs,
+    // requires a < b * B^n and the highest bit of b set
+    void div_two_halves(natural const& a, natural const& b, size_t n, natural& q, natural& r) {
+        if (n % 2 == 1 || n < BURNIKEL_ZIEGLER_THRESHOLD) {
+            div_natural_basecase(a, b, q, r);
+            return;
+        }
+        size_t half = n / 2;
+        natural q1, r1;
+        div_three_halves(slice_natural(a, half, 3 * half), b, half, q1, r1);
+        div_three_halves(join_natural(r1, half, slice_natural(a, 0, half)), b, half, q, r);
+        q = join_natural(q1, half, q);
+    }
+
+    // q = a / b and r = a % b for b != 0. The divisor is padded to a block of j * 2^k limbs
+    // with j <= BURNIKEL_ZIEGLER_THRESHOLD and the dividend is consumed block by block.
+    void div_burnikel_ziegler(natural const& a, natural const& b, natural& q, natural& r) {
+        size_t j = b.size();
+        size_t k = 0;
+        while (j > BURNIKEL_ZIEGLER_THRESHOLD) {
+            j = (j + 1) / 2;
+            ++k;
+        }
+        size_t block = j << k;
+        size_t shift = (block - b.size()) * LIMB_BITS + leading_zeros(b.back());
+        natural bs = shift_left_natural(b, shift);
+        natural as = shift_left_natural(a, shift);
+        // the top block must be below bs, which holds when its highest bit is clear
+        size_t t = std::max<size_t>(2, (as.size() * LIMB_BITS + 1 + block * LIMB_BITS - 1) /
+                                       (block * LIMB_BITS));
+        if (as.size() == t * block && (as.back() >> (LIMB_BITS - 1)) != 0) {
+            ++t;
+        }
+        natural z = slice_natural(as, (t - 2) * block, 2 * block);
+        q.assign((t - 1) * block, 0);
+        for (size_t i = t - 1; i-- > 0;) {
+            natural qi;
+            div_two_halves(z, bs, block, qi, r);
+            std::copy(qi.begin(), qi.end(), q.begin() + i * block);
+            if (i != 0) {
+                z = join_natural(r, block, slice_natural(as, (i - 1) * block, block));
+            }
+        }
+        trim_natural(q);
+        r = shift_right_natural(r, shift);
+    }
+
+    // floor(B^(2 * n) / d) for d of n limbs with the highest bit set. The reciprocal of the
+    // upper half of d gives half of the digits, one Newton step y += y * (B^(2 * n) - d * y)
+    // doubles them and the few units of error left are corrected against the exact remainder.
+    natural reciprocal_natural(natural const& d) {
+        size_t n = d.size();
+        natural power(2 * n + 1, 0);
+        power.back() = 1;
+        if (n <= BARRETT_THRESHOLD) {
+            natural q, r;
+            div_natural_basecase(power, d, q, r);
+            return q;
+        }
+        size_t h = (n + 1) / 2;
+        natural y = join_natural(reciprocal_natural(slice_natural(d, n - h, h)), n - h, natural());
+        natural dy = mul_natural(d, y);
+        if (compare_natural(dy, power) <= 0) {
+            natural e = power;
+            sub_natural(e, dy);
+            add_natural(y, slice_natural(mul_natural(y, e), 2 * n, 2 * n + 2));
+        } else {
+            natural e = dy;
+            sub_natural(e, power);
+            sub_natural(y, slice_natural(mul_natural(y, e), 2 * n, 2 * n + 2));
+        }
+        natural one(1, 1);
+        dy = mul_natural(d, y);
+        while (compare_natural(dy, power) > 0) {
+            sub_natural(y, one);
+            sub_natural(dy, d);
+        }
+        sub_natural(power, dy);
+        while (compare_natural(power, d) >= 0) {
+            add_natural(y, one);
+            sub_natural(power, d);
+        }
+        return y;
+    }
+
+    // Barrett reduction of a < d * B^n for d of n limbs with the highest bit set
+    // and y = floor(B^(2 * n) / d), the estimate is at most two below the quotient
+    void div_barrett(natural const& a, natural const& d, natural const& y, natural& q, natural& r) {
+        size_t n = d.size();
+        q = slice_natural(mul_natural(slice_natural(a, n - 1, n + 1), y), n + 1, n + 1);
+        r = a;
+        sub_natural(r, mul_natural(q, d));
+        natural one(1, 1);
+        while (compare_natural(r, d) >= 0) {
+            sub_natural(r, d);
+            add_natural(q, one);
+        }
+    }
+
+    // q = a / b and r = a % b for b != 0
+    void div_natural(natural const& a, natural const& b, natural& q, natural& r) {
+        if (b.size() >= BURNIKEL_ZIEGLER_THRESHOLD) {
+            div_burnikel_ziegler(a, b, q, r);
+        } else {
+            uint32_t norm = leading_zeros(b.back());
+            div_natural_basecase(shift_left_natural(a, norm), shift_left_natural(b, norm), q, r);
+            r = shift_right_natural(r, norm);
+        }
+    }
+
+    // bits of the windows for an exponent of the given length, balancing the 2^(window - 1)
+    // precomputed odd powers against the multiplications they save
+    size_t window_size(size_t bits) {
+        size_t window = 1;
+        for (size_t limit : {8, 24, 80, 240, 672, 1792}) {
+            window += bits > limit;
+        }
+        return window;
+    }
+
+    // Left-to-right sliding window exponentiation by e[0..n), which has no high zero limbs:
+    // calls square() for every bit after the first window and multiply(i, first) for the
+    // product with base^(2 i + 1), where the first one is an assignment.
+    template <typename Square, typename Multiply>
+    void sliding_window(limb const* e, size_t n, size_t window, Square square, Multiply multiply) {
+        auto bit = [e](size_t i) { return (e[i / LIMB_BITS] >> (i % LIMB_BITS)) & 1; };
+        bool first = true;
+        for (size_t i = n == 0 ? 0 : n * LIMB_BITS - leading_zeros(e[n - 1]); i-- > 0;) {
+            if (!bit(i)) {
+                square();
+                continue;
+            }
+            size_t low = i + 1 > window ? i + 1 - window : 0;
+            while (!bit(low)) {
+                ++low;
+            }
+            size_t value = 0;
+            for (size_t j = i + 1; j-- > low;) {
+                value = value << 1 | bit(j);
+                if (!first) {
+                    square();
+                }
+            }
+            multiply(value >> 1, first);
+            first = false;
+            i = low;
+        }
+    }
+
+    // -n^-1 mod B for an odd n, Newton's iteration doubles the correct low bits
+    // and n is its own inverse modulo 8
+    limb negated_inverse(limb n) {
+        limb inverse = n;
+        for (int i = 0; i < 5; ++i) {
+            inverse *= 2 - n * inverse;
+        }
+        return 0 - inverse;
+    }
+
+    // -n^-1 mod R in n.size() limbs, R = B^n.size(): y = y (2 + n y) doubles the correct
+    // limbs of the negated inverse
+    natural montgomery_inverse(natural const& n) {
+        natural y(1, negated_inverse(n[0]));
+        for (size_t p = 1; p < n.size();) {
+            p = std::min(2 * p, n.size());
+            natural t = mul_natural(slice_natural(n, 0, p), y);
+            add_natural(t, natural(1, 2));
+            y = slice_natural(mul_natural(y, slice_natural(t, 0, p)), 0, p);
+        }
+        y.resize(n.size(), 0);
+        return y;
+    }
+
+    // R^2 mod n in n.size() limbs, R = B^n.size()
+    natural montgomery_r2(natural const& n) {
+        natural power(2 * n.size() + 1, 0);
+        power.back() = 1;
+        natural q, r;
+        div_natural(power, n, q, r);
+        r.resize(n.size(), 0);
+        return r;
+    }
+
+    // Montgomery arithmetic modulo an odd n of k limbs with R = B^k, over constants stored
+    // elsewhere. Residues are kept as a R mod n in k limbs, so a product is a multiplication
+    // of k limbs followed by a reduction, limb by limb for short moduli and by two more
+    // products of k limbs from REDC_THRESHOLD up. The temporaries go in a workspace of
+    // workspace_size() limbs, which is all the memory needed below the NTT threshold.
+    struct montgomery_modulus {
+        limb const* n;
+        size_t k;
+        limb n_inv; // -n^-1 mod B
+        limb const* r2; // R^2 mod n
+        limb const* n_inv_r; // -n^-1 mod R, from REDC_THRESHOLD limbs
+
+        static bool whole_redc(size_t k) {
+            return k >= REDC_THRESHOLD;
+        }
+
+        size_t workspace_size() const {
+            return (whole_redc(k) ? 6 : 2) * k + mul_scratch_size(k);
+        }
+
+        // r = t / R mod n for t[0..2k) < n R at the start of the workspace, t is overwritten
+        void reduce(limb* r, limb* t) const {
+            limb high = 0;
+            if (whole_redc(k)) {
+                // q = t n' mod R makes t + q n a multiple of R, whose low half is zero or R
+                limb* q = t + 2 * k;
+                limb* qn = q + 2 * k;
+                mul_balanced(q, t, n_inv_r, k, qn + 2 * k);
+                mul_balanced(qn, q, n, k, qn + 2 * k);
+                limb carry = std::any_of(t, t + k, [](limb x) { return x != 0; }) ? 1 : 0;
+                high = add_n(t + k, t + k, qn + k, k);
+                for (size_t i = k; i < 2 * k && carry; ++i) {
+                    carry = (++t[i] == 0);
+                }
+                high += carry;
+            } else {
+                for (size_t i = 0; i < k; ++i) {
+                    limb carry = addmul_1(t + i, n, k, t[i] * n_inv);
+                    double_limb sum = static_cast<double_limb>(t[i + k]) + carry + high;
+                    t[i + k] = get_low(sum);
+                    high = get_high(sum);
+                }
+            }
+            // the sum is below 2 n
+            if (high != 0 || compare_n(t + k, n, k) >= 0) {
+                sub_n(r, t + k, n, k);
+            } else {
+                std::copy(t + k, t + 2 * k, r);
+            }
+        }
+
+        // r = a b / R mod n, r may be a or b
+        void mul(limb* r, limb const* a, limb const* b, limb* work) const {
+            mul_balanced(work, a, b, k, work + 2 * k);
+            reduce(r, work);
+        }
+
+        void sqr(limb* r, limb const* a, limb* work) const {
+            sqr_balanced(work, a, k, work + 2 * k);
+            reduce(r, work);
+        }
+
+        // r = a R mod n for a < n
+        void to_form(limb* r, limb const* a, limb* work) const {
+            mul(r, a, r2, work);
+        }
+
+        void from_form(limb* r, limb const* a, limb* work) const {
+            std::copy(a, a + k, work);
+            std::fill(work + k, work + 2 * k, 0);
+            reduce(r, work);
+        }
+
+        size_t pow_workspace_size(size_t window) const {
+            return workspace_size() + (k << (window - 1)) + 2 * k;
+        }
+
+        // r = a^e for a residue a and a nonzero e[0..en) without high zero limbs, the
+        // workspace holds pow_workspace_size(window) limbs; r may be a
+        void pow(limb* r, limb const* a, limb const* e, size_t en, size_t window, limb* work) const {
+            limb* powers = work + workspace_size();
+            limb* a_squared = powers + (k << (window - 1));
+            limb* x = a_squared + k;
+            std::copy(a, a + k, powers);
+            if (window > 1) {
+                sqr(a_squared, a, work);
+                for (size_t i = k; i < (k << (window - 1)); i += k) {
+                    mul(powers + i, powers + i - k, a_squared, work);
+                }
+            }
+            sliding_window(e, en, window, [&] { sqr(x, x, work); }, [&](size_t i, bool first) {
+                if (first) {
+                    std::copy(powers + i * k, powers + (i + 1) * k, x);
+                } else {
+                    mul(x, x, powers + i * k, work);
+                }
+            });
+            std::copy(x, x + k, r);
+        }
+    };
+
+    size_t bit_length_natural(natural const& a) {
+        return a.empty() ? 0 : a.size() * LIMB_BITS - leading_zeros(a.back());
+    }
+
+    natural limb_natural(limb x) {
+        return x == 0 ? natural() : natural(1, x);
+    }
+
+    // Steps of Euclid's algorithm as the matrix M with (a, b) = M (a', b') for the remainders
+    // a', b' they lead to: the product of [[q, 1], [1, 0]] for every quotient q, whose
+    // determinant is -1 if odd is set.
+    struct euclid_matrix {
+        natural m[2][2];
+        bool odd = false;
+
+        euclid_matrix() : m{{natural(1, 1), natural()}, {natural(), natural(1, 1)}} {}
+
+        bool identity() const {
+            return m[0][1].empty() && m[1][0].empty();
+        }
+
+        // M = M [[q, 1], [1, 0]]
+        void step(natural const& q) {
+            for (natural* row : {m[0], m[1]}) {
+                natural t = mul_natural(row[0], q);
+                add_natural(t, row[1]);
+                row[1] = std::move(row[0]);
+                row[0] = std::move(t);
+            }
+            odd = !odd;
+        }
+
+        // M = M N
+        void multiply(euclid_matrix const& n) {
+            if (n.identity()) {
+                return;
+            }
+            for (natural* row : {m[0], m[1]}) {
+                natural left = mul_natural(row[0], n.m[0][0]);
+                add_natural(left, mul_natural(row[1], n.m[1][0]));
+                natural right = mul_natural(row[0], n.m[0][1]);
+                add_natural(right, mul_natural(row[1], n.m[1][1]));
+                row[0] = std::move(left);
+                row[1] = std::move(right);
+            }
+            odd ^= n.odd;
+        }
+
+        // (a, b) = M^-1 (a, b) if that leaves a > b >= 0, returns whether it did
+        bool reduce(natural& a, natural& b) const {
+            natural p = mul_natural(m[1][1], a);
+            natural q = mul_natural(m[0][1], b);
+            natural r = mul_natural(m[0][0], b);
+            natural s = mul_natural(m[1][0], a);
+            if (odd) {
+                p.swap(q);
+                r.swap(s);
+            }
+            if (compare_natural(p, q) < 0 || compare_natural(r, s) < 0) {
+                return false;
+            }
+            sub_natural(p, q);
+            sub_natural(r, s);
+            if (compare_natural(p, r) <= 0) {
+                return false;
+            }
+            a = std::move(p);
+            b = std::move(r);
+            return true;
+        }
+    };
+
+    // a >> shift for a shift that leaves less than two limbs
+    double_limb shifted_bits(natural const& a, size_t shift) {
+        auto at = [&a](size_t i) { return static_cast<double_limb>(i < a.size() ? a[i] : 0); };
+        size_t i = shift / LIMB_BITS;
+        uint32_t r = shift % LIMB_BITS;
+        double_limb result = (at(i) | at(i + 1) << LIMB_BITS) >> r;
+        if (r != 0) {
+            result |= at(i + 2) << (2 * LIMB_BITS - r);
+        }
+        return result;
+    }
+
+    // Lehmer's algorithm for a >= b with at least three limbs in a: Euclid's algorithm runs on
+    // the leading 2 LIMB_BITS - 2 bits as long as Jebelean's condition makes sure its quotients
+    // are those of a and b, which keeps the cofactors below B / 2. Returns the number k of
+    // steps; they take (a, b) to (A a - B b, D b - C a) if k is even and to
+    // (A b - B a, D a - C b) if it is odd, for the cofactors A, B, C, D.
+    size_t lehmer_cofactors(natural const& a, natural const& b, limb* cofactors) {
+        size_t shift = bit_length_natural(a) - (2 * LIMB_BITS - 2);
+        double_limb x = shifted_bits(a, shift);
+        double_limb y = shifted_bits(b, shift);
+        double_limb A = 1, B = 0, C = 0, D = 1;
+        size_t k = 0;
+        for (; y != 0; ++k) {
+            double_limb q = x / y;
+            double_limb t = x - q * y;
+            double_limb s = B + q * D;
+            double_limb u = A + q * C;
+            double_limb next = std::max(s, u);
+            if (t < next || y - t < next + std::max(C, D)) {
+                break;
+            }
+            x = y;
+            y = t;
+            A = D;
+            B = C;
+            C = s;
+            D = u;
+        }
+        cofactors[0] = get_low(A);
+        cofactors[1] = get_low(B);
+        cofactors[2] = get_low(C);
+        cofactors[3] = get_low(D);
+        return k;
+    }
+
+    euclid_matrix lehmer_matrix(limb const* cofactors, size_t k) {
+        euclid_matrix result;
+        bool odd = k % 2 != 0;
+        result.m[0][0] = limb_natural(cofactors[odd ? 2 : 3]);
+        result.m[0][1] = limb_natural(cofactors[odd ? 0 : 1]);
+        result.m[1][0] = limb_natural(cofactors[odd ? 3 : 2]);
+        result.m[1][1] = limb_natural(cofactors[odd ? 1 : 0]);
+        result.odd = odd;
+        return result;
+    }
+
+    // the steps of lehmer_cofactors applied to a and b in place
+    void lehmer_apply(natural& a, natural& b, limb const* cofactors, size_t k) {
+        size_t n = a.size();
+        b.resize(n, 0);
+        natural const& first = k % 2 == 0 ? a : b;
+        natural const& second = k % 2 == 0 ? b : a;
+        natural c(first);
+        natural d(second);
+        c.push_back(mul_add_1(c.data(), n, cofactors[0], 0));
+        c.back() -= submul_1(c.data(), second.data(), n, cofactors[1]);
+        d.push_back(mul_add_1(d.data(), n, cofactors[3], 0));
+        d.back() -= submul_1(d.data(), first.data(), n, cofactors[2]);
+        trim_natural(c);
+        trim_natural(d);
+        a = std::move(c);
+        b = std::move(d);
+    }
+
+    // a, b = b, a % b if the remainder keeps at least s bits, returns whether it did
+    bool euclid_step(natural& a, natural& b, size_t s, euclid_matrix* total) {
+        natural q, r;
+        div_natural(a, b, q, r);
+        if (bit_length_natural(r) < s) {
+            return false;
+        }
+        if (total != nullptr) {
+            total->step(q);
+        }
+        a = std::move(b);
+        b = std::move(r);
+        return true;
+    }
+
+    euclid_matrix hgcd(natural& a, natural& b, size_t s);
+
+    // Reduces a and b by the steps hgcd finds for their bits above the k lowest ones, which
+    // are theirs as long as the remainders keep about half of those bits; the steps are
+    // checked against the whole numbers.
+    void hgcd_part(natural& a, natural& b, size_t k, size_t s, euclid_matrix& total) {
+        natural x = shift_right_natural(a, k);
+        natural y = shift_right_natural(b, k);
+        size_t t = std::max(s > k ? s - k : 0, bit_length_natural(x) / 2 + 2);
+        euclid_matrix m = hgcd(x, y, t);
+        natural c = a;
+        natural d = b;
+        if (!m.identity() && m.reduce(c, d) && bit_length_natural(d) >= s) {
+            a = std::move(c);
+            b = std::move(d);
+            total.multiply(m);
+        }
+    }
+
+    // Schönhage's half-gcd: runs Euclid's algorithm on a > b as long as the remainders keep at
+    // least s bits. Both halves of the way are found recursively from the leading bits, so
+    // it costs O(M(n) log n) for numbers of n limbs. Returns the matrix of the steps.
+    euclid_matrix hgcd(natural& a, natural& b, size_t s) {
+        euclid_matrix total;
+        if (bit_length_natural(b) < s) {
+            return total;
+        }
+        if (b.size() >= HGCD_THRESHOLD) {
+            size_t n = bit_length_natural(a);
+            hgcd_part(a, b, n / 2, s, total);
+            euclid_step(a, b, s, &total);
+            n = bit_length_natural(a);
+            if (2 * s > n + 4) {
+                hgcd_part(a, b, 2 * s - n - 4, s, total);
+            }
+        }
+        bool lehmer = true;
+        while (!b.empty()) {
+            limb cofactors[4];
+            size_t k = lehmer && a.size() > 2 ? lehmer_cofactors(a, b, cofactors) : 0;
+            if (k != 0) {
+                euclid_matrix m = lehmer_matrix(cofactors, k);
+                natural c = a;
+                natural d = b;
+                if (m.reduce(c, d) && bit_length_natural(d) >= s) {
+                    a = std::move(c);
+                    b = std::move(d);
+                    total.multiply(m);
+                    continue;
+                }
+                // too far, the last steps go one at a time
+                lehmer = false;
+            }
+            if (!euclid_step(a, b, s, &total)) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    uint32_t trailing_zeros(double_limb x) {
+        return get_low(x) != 0 ? __builtin_ctzll(get_low(x)) : LIMB_BITS + __builtin_ctzll(get_high(x));
+    }
+
+    // binary gcd of numbers of up to two limbs
+    double_limb gcd_double(double_limb a, double_limb b) {
+        if (a == 0 || b == 0) {
+            return a | b;
+        }
+        uint32_t shift = trailing_zeros(a | b);
+        a >>= trailing_zeros(a);
+        while (b != 0) {
+            b >>= trailing_zeros(b);
+            if (a > b) {
+                std::swap(a, b);
+            }
+            b -= a;
+        }
+        return a << shift;
+    }
+
+    // gcd(a, b) for a >= b: half-gcd for large numbers, Lehmer's algorithm for medium ones and
+    // the binary algorithm for two limbs. With total, also the matrix of the steps taking
+    // (a, b) to (gcd, 0). The half-gcd pays off sooner then, since Lehmer's steps would have
+    // to be multiplied into total one by one.
+    natural gcd_natural(natural a, natural b, euclid_matrix* total) {
+        size_t threshold = total != nullptr ? HGCD_THRESHOLD : GCD_HGCD_THRESHOLD;
+        while (!b.empty()) {
+            if (b.size() >= threshold) {
+                euclid_matrix m = hgcd(a, b, bit_length_natural(a) / 2);
+                if (total != nullptr) {
+                    total->multiply(m);
+                }
+                if (!b.empty()) {
+                    euclid_step(a, b, 0, total);
+                }
+            } else if (a.size() > 2) {
+                limb cofactors[4];
+                size_t k = lehmer_cofactors(a, b, cofactors);
+                if (k == 0) {
+                    euclid_step(a, b, 0, total);
+                } else {
+                    lehmer_apply(a, b, cofactors, k);
+                    if (total != nullptr) {
+                        total->multiply(lehmer_matrix(cofactors, k));
+                    }
+                }
+            } else if (total != nullptr) {
+                euclid_step(a, b, 0, total);
+            } else {
+                auto value = [](natural const& x) { return (x.size() > 1 ? set_high(x[1]) : 0) | x[0]; };
+                double_limb g = gcd_double(value(a), value(b));
+                a.assign({get_low(g), get_high(g)});
+                trim_natural(a);
+                return a;
+            }
+        }
+        return a;
+    }
+
+    // temporaries of the modular operations, kept per thread so that a mod_context can be shared
+    limb* modular_workspace(size_t size) {
+        thread_local natural workspace;
+        if (workspace.size() < size) {
+            workspace.resize(size);
+        }
+        return workspace.data();
+    }
+
+    // Kernels for decimal digits, which go eight at a time since 10^8 < 2^32: a run of digits
+    // is validated, groups of 8 digits are converted to and from 32-bit values. On x86-64 they
+    // use SSE2, which every such processor has, or AVX2 if the processor supports it.
+
+    // end of the run of decimal digits starting at first
+    char const* scan_decimal_scalar(char const* first, char const* last) {
+        while (first != last && static_cast<unsigned char>(*first - '0') < 10) {
+            ++first;
+        }
+        return first;
+    }
+
+    // out[i] = the value of the 8 digits at first + i * stride
+    void parse_groups_scalar(char const* first, size_t stride, size_t count, uint32_t* out) {
+        for (size_t i = 0; i < count; ++i, first += stride) {
+            uint32_t value = 0;
+            for (size_t j = 0; j < 8; ++j) {
+                value = value * 10 + static_cast<uint32_t>(first[j] - '0');
+            }
+            out[i] = value;
+        }
+    }
+
+    // writes groups[i] < 10^8 as 8 digits at first + i * stride
+    void format_groups_scalar(uint32_t const* groups, size_t count, char* first, size_t stride) {
+        for (size_t i = 0; i < count; ++i, first += stride) {
+            uint32_t value = groups[i];
+            for (size_t j = 8; j-- > 0; value /= 10) {
+                first[j] = static_cast<char>('0' + value % 10);
+            }
+        }
+    }
+
+#ifdef __x86_64__
+    // Digits in bytes become 2-digit values in 16-bit lanes, 4-digit values in 32-bit lanes
+    // and 8-digit values in 64-bit lanes, the first digit being the highest.
+    __m128i parse_groups_128(__m128i digits) {
+        __m128i t = _mm_sub_epi8(digits, _mm_set1_epi8('0'));
+        __m128i pairs = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(t, _mm_set1_epi16(0xff)), _mm_set1_epi16(10)),
+                                      _mm_srli_epi16(t, 8));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010064)); // 100 * high pair + low pair
+        return _mm_add_epi64(_mm_mul_epu32(quads, _mm_set1_epi32(10000)), _mm_srli_epi64(quads, 32));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i parse_groups_256(__m256i digits) {
+        __m256i t = _mm256_sub_epi8(digits, _mm256_set1_epi8('0'));
+        __m256i pairs = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_and_si256(t, _mm256_set1_epi16(0xff)),
+                                                            _mm256_set1_epi16(10)),
+                                         _mm256_srli_epi16(t, 8));
+        __m256i quads = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00010064));
+        return _mm256_add_epi64(_mm256_mul_epu32(quads, _mm256_set1_epi32(10000)), _mm256_srli_epi64(quads, 32));
+    }
+
+    // The reverse: 8-digit values in 64-bit lanes are split by 10^4, 10^2 and 10 with
+    // multiplications by reciprocals into ASCII digits, the highest first.
+    __m128i format_groups_128(__m128i groups) {
+        __m128i high = _mm_srli_epi64(_mm_mul_epu32(groups, _mm_set1_epi32(static_cast<int>(0xd1b71759))), 45);
+        __m128i low = _mm_sub_epi32(groups, _mm_mul_epu32(high, _mm_set1_epi32(10000)));
+        __m128i quads = _mm_or_si128(high, _mm_slli_epi64(low, 32));
+        __m128i hundreds = _mm_srli_epi16(_mm_mulhi_epu16(quads, _mm_set1_epi16(5243)), 3);
+        __m128i pairs = _mm_or_si128(hundreds,
+                                     _mm_slli_epi32(_mm_sub_epi16(quads, _mm_mullo_epi16(hundreds, _mm_set1_epi16(100))), 16));
+        __m128i tens = _mm_mulhi_epu16(pairs, _mm_set1_epi16(6554));
+        __m128i digits = _mm_or_si128(tens, _mm_slli_epi16(_mm_sub_epi16(pairs, _mm_mullo_epi16(tens, _mm_set1_epi16(10))), 8));
+        return _mm_add_epi8(digits, _mm_set1_epi8('0'));
+    }
+
+    __attribute__((target("avx2")))
+    __m256i format_groups_256(__m256i groups) {
+        __m256i high = _mm256_srli_epi64(_mm256_mul_epu32(groups, _mm256_set1_epi32(static_cast<int>(0xd1b71759))), 45);
+        __m256i low = _mm256_sub_epi32(groups, _mm256_mul_epu32(high, _mm256_set1_epi32(10000)));
+        __m256i quads = _mm256_or_si256(high, _mm256_slli_epi64(low, 32));
+        __m256i hundreds = _mm256_srli_epi16(_mm256_mulhi_epu16(quads, _mm256_set1_epi16(5243)), 3);
+        __m256i pairs = _mm256_or_si256(
+                hundreds, _mm256_slli_epi32(_mm256_sub_epi16(quads, _mm256_mullo_epi16(hundreds, _mm256_set1_epi16(100))), 16));
+        __m256i tens = _mm256_mulhi_epu16(pairs, _mm256_set1_epi16(6554));
+        __m256i digits = _mm256_or_si256(
+                tens, _mm256_slli_epi16(_mm256_sub_epi16(pairs, _mm256_mullo_epi16(tens, _mm256_set1_epi16(10))), 8));
+        return _mm256_add_epi8(digits, _mm256_set1_epi8('0'));
+    }
+
+    __m128i load_group(char const* p) {
+        return _mm_loadl_epi64(reinterpret_cast<__m128i const*>(p));
+    }
+
+    void store_group(char* p, __m128i digits) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), digits);
+    }
+
+    char const* scan_decimal_sse2(char const* first, char const* last) {
+        for (; last - first >= 16; first += 16) {
+            __m128i t = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(first)), _mm_set1_epi8('0'));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t)));
+            if (mask != 0xffff) {
+                return first + __builtin_ctz(~mask);
+            }
+        }
+        return scan_decimal_scalar(first, last);
+    }
+
+    __attribute__((target("avx2")))
+    char const* scan_decimal_avx2(char const* first, char const* last) {
+        for (; last - first >= 32; first += 32) {
+            __m256i t = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(first)),
+                                        _mm256_set1_epi8('0'));
+            unsigned mask = static_cast<unsigned>(
+                    _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(9)), t)));
+            if (mask != 0xffffffff) {
+                return first + __builtin_ctz(~mask);
+            }
+        }
+        _mm256_zeroupper(); // the SSE2 code below would pay for dirty upper halves
+        return scan_decimal_sse2(first, last);
+    }
+
+    void parse_groups_sse2(char const* first, size_t stride, size_t count, uint32_t* out) {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2, first += 2 * stride) {
+            __m128i values = parse_groups_128(_mm_unpacklo_epi64(load_group(first), load_group(first + stride)));
+            out[i] = static_cast<uint32_t>(_mm_cvtsi128_si32(values));
+            out[i + 1] = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(values, 8)));
+        }
+        parse_groups_scalar(first, stride, count - i, out + i);
+    }
+
+    __attribute__((target("avx2")))
+    void parse_groups_avx2(char const* first, size_t stride, size_t count, uint32_t* out) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4, first += 4 * stride) {
+            __m128i low = _mm_unpacklo_epi64(load_group(first), load_group(first + stride));
+            __m128i high = _mm_unpacklo_epi64(load_group(first + 2 * stride), load_group(first + 3 * stride));
+            __m256i values = parse_groups_256(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1));
+            // the values are the even 32-bit lanes
+            __m256i packed = _mm256_permutevar8x32_epi32(values, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(packed));
+        }
+        _mm256_zeroupper();
+        parse_groups_sse2(first, stride, count - i, out + i);
+    }
+
+    void format_groups_sse2(uint32_t const* groups, size_t count, char* first, size_t stride) {
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2, first += 2 * stride) {
+            __m128i digits = format_groups_128(_mm_set_epi64x(groups[i + 1], groups[i]));
+            store_group(first, digits);
+            store_group(first + stride, _mm_unpackhi_epi64(digits, digits));
+        }
+        format_groups_scalar(groups + i, count - i, first, stride);
+    }
+
+    __attribute__((target("avx2")))
+    void format_groups_avx2(uint32_t const* groups, size_t count, char* first, size_t stride) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4, first += 4 * stride) {
+            __m256i digits = format_groups_256(_mm256_setr_epi64x(groups[i], groups[i + 1], groups[i + 2], groups[i + 3]));
+            __m128i low = _mm256_castsi256_si128(digits);
+            __m128i high = _mm256_extracti128_si256(digits, 1);
+            store_group(first, low);
+            store_group(first + stride, _mm_unpackhi_epi64(low, low));
+            store_group(first + 2 * stride, high);
+            store_group(first + 3 * stride, _mm_unpackhi_epi64(high, high));
+        }
+        _mm256_zeroupper();
+        format_groups_sse2(groups + i, count - i, first, stride);
+    }
+#endif
+
+    struct decimal_kernels {
+        char const* (*scan)(char const* first, char const* last);
+        void (*parse_groups)(char const* first, size_t stride, size_t count, uint32_t* out);
+        void (*format_groups)(uint32_t const* groups, size_t count, char* first, size_t stride);
+    };
+
+    decimal_kernels const SCALAR_KERNELS{scan_decimal_scalar, parse_groups_scalar, format_groups_scalar};
+#ifdef __x86_64__
+    decimal_kernels const SSE2_KERNELS{scan_decimal_sse2, parse_groups_sse2, format_groups_sse2};
+    decimal_kernels const AVX2_KERNELS{scan_decimal_avx2, parse_groups_avx2, format_groups_avx2};
+#endif
+
+    // the set for the kind, null if the processor or the target lacks it
+    decimal_kernels const* find_decimal_kernels(decimal_kernel_set kind) {
+        switch (kind) {
+        case decimal_kernel_set::scalar:
+            return &SCALAR_KERNELS;
+#ifdef __x86_64__
+        case decimal_kernel_set::sse2:
+            return &SSE2_KERNELS;
+        case decimal_kernel_set::avx2:
+            return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : nullptr;
+        case decimal_kernel_set::automatic:
+            return __builtin_cpu_supports("avx2") ? &AVX2_KERNELS : &SSE2_KERNELS;
+#else
+        case decimal_kernel_set::automatic:
+            return &SCALAR_KERNELS;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    // chosen once for the processor unless set_decimal_kernels switches them
+    std::atomic<decimal_kernels const*>& current_decimal_kernels() {
+        static std::atomic<decimal_kernels const*> kernels(find_decimal_kernels(decimal_kernel_set::automatic));
+        return kernels;
+    }
+
+    decimal_kernels const& get_decimal_kernels() {
+        return *current_decimal_kernels().load(std::memory_order_relaxed);
+    }
+
+    // Conversions in a base that is not a power of two work on chunks of the most digits
+    // whose value fits a limb, e.g. 10^9 for 32-bit limbs.
+    struct radix {
+        uint32_t base;
+        uint32_t chunk_digits;
+        limb chunk; // base^chunk_digits
+
+        explicit radix(uint32_t base) : base(base), chunk_digits(0), chunk(1) {
+            while (chunk <= LIMB_MAX / base) {
+                chunk *= base;
+                ++chunk_digits;
+            }
+        }
+    };
+
+    // The decimal radix as compile-time constants, so that the leaf divisions become
+    // multiplications.
+    struct decimal_radix {
+        constexpr static const uint32_t base = 10;
+        constexpr static const uint32_t chunk_digits = LIMB_BITS == 64 ? 19 : 9;
+        constexpr static const limb chunk = LIMB_BITS == 64 ? 10000000000000000000ull : 1000000000;
+    };
+
+    constexpr static const uint32_t MAX_BASE = 36;
+    constexpr static const char DIGITS[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+    // value of a digit in bases up to 36, MAX_BASE for any other character
+    uint32_t digit_value(char c) {
+        if (c >= '0' && c <= '9') {
+            return static_cast<uint32_t>(c - '0');
+        } else if (c >= 'a' && c <= 'z') {
+            return static_cast<uint32_t>(c - 'a') + 10;
+        } else if (c >= 'A' && c <= 'Z') {
+            return static_cast<uint32_t>(c - 'A') + 10;
+        }
+        return MAX_BASE;
+    }
+
+    uint32_t checked_base(int base) {
+        if (base < 2 || base > static_cast<int>(MAX_BASE)) {
+            throw std::invalid_argument("Invalid base");
+        }
+        return static_cast<uint32_t>(base);
+    }
+
+    // log2 of a power of two base, 0 for other bases
+    uint32_t base_bits(uint32_t base) {
+        return (base & (base - 1)) == 0 ? static_cast<uint32_t>(__builtin_ctz(base)) : 0;
+    }
+
+    // Process-wide table of chunk^(2^k) for every base. Entries are immutable and shared, so
+    // a conversion keeps the ones it took even if the table is shrunk meanwhile.
+    struct radix_cache {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<natural const>> powers[MAX_BASE + 1];
+        size_t bytes = 0;
+        size_t limit = RADIX_CACHE_LIMIT;
+    };
+
+    radix_cache& get_radix_cache() {
+        static radix_cache cache;
+        return cache;
+    }
+
+    typedef std::vector<std::shared_ptr<natural const>> power_list;
+
+    // powers[k] = chunk^(2^k) for one conversion. Missing powers are taken from the table,
+    // or built by squaring outside the lock and published while the table stays within
+    // its limit; the ones that do not fit are kept only by the conversion.
+    natural const& radix_power(radix const& r, power_list& powers, size_t k) {
+        radix_cache& cache = get_radix_cache();
+        std::vector<std::shared_ptr<natural const>>& table = cache.powers[r.base];
+        while (powers.size() <= k) {
+            size_t i = powers.size();
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                if (i < table.size()) {
+                    powers.push_back(table[i]);
+                    continue;
+                }
+            }
+            std::shared_ptr<natural const> power = std::make_shared<natural const>(
+                    i == 0 ? natural(1, r.chunk) : mul_natural(*powers.back(), *powers.back()));
+            size_t bytes = power->size() * sizeof(limb);
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                if (table.size() == i && cache.bytes + bytes <= cache.limit) {
+                    table.push_back(power);
+                    cache.bytes += bytes;
+                }
+            }
+            powers.push_back(std::move(power));
+        }
+        return *powers[k];
+    }
+
+    constexpr static const size_t DECIMAL_BATCH = 64; // chunks converted by the kernels at once
+
+    // value of the decimal chunk at p from the values of its 8-digit groups
+    limb decimal_chunk(char const* p, uint32_t const* groups, size_t i, size_t count) {
+#if BIG_INTEGER_LIMB_BITS == 64
+        // 8 + 8 + 3 digits
+        limb value = static_cast<limb>(groups[i]) * 100000000 + groups[count + i];
+        return ((value * 10 + (p[16] - '0')) * 10 + (p[17] - '0')) * 10 + (p[18] - '0');
+#else
+        // 8 + 1 digits
+        static_cast<void>(count);
+        return static_cast<limb>(groups[i]) * 10 + static_cast<limb>(p[8] - '0');
+#endif
+    }
+
+    // parse_basecase for base 10, the full chunks are converted by the kernels
+    template <typename Storage>
+    void parse_decimal_basecase(char const* first, char const* last, Storage& result) {
+        constexpr size_t digits = decimal_radix::chunk_digits;
+        result.clear();
+        limb head = 0;
+        for (size_t i = (last - first) % digits; i != 0; --i, ++first) {
+            head = head * 10 + static_cast<limb>(*first - '0');
+        }
+        if (head != 0) {
+            result.emplace_back(head);
+        }
+        decimal_kernels const& kernels = get_decimal_kernels();
+        uint32_t groups[DECIMAL_BATCH * (digits / 8)];
+        while (first != last) {
+            size_t count = std::min(static_cast<size_t>(last - first) / digits, DECIMAL_BATCH);
+            for (size_t j = 0; j < digits / 8; ++j) {
+                kernels.parse_groups(first + 8 * j, digits, count, groups + j * count);
+            }
+            for (size_t i = 0; i < count; ++i, first += digits) {
+                limb carry = mul_add_1(result.data(), result.size(), decimal_radix::chunk,
+                                       decimal_chunk(first, groups, i, count));
+                if (carry != 0) {
+                    result.emplace_back(carry);
+                }
+            }
+        }
+    }
+
+    // digits [first, last) consumed a chunk at a time, one pass over the limbs each; the
+    // result is a natural or the digits of a big_integer, whose buffer is then reused
+    template <typename Storage>
+    void parse_basecase(radix const& r, char const* first, char const* last, Storage& result) {
+        if (r.base == decimal_radix::base) {
+            parse_decimal_basecase(first, last, result);
+            return;
+        }
+        result.clear();
+        size_t head = (last - first) % r.chunk_digits;
+        for (char const* chunk_end = first + (head == 0 ? r.chunk_digits : head); first != last;
+             chunk_end += r.chunk_digits) {
+            limb chunk = 0;
+            limb scale = 1;
+            for (; first != chunk_end; ++first) {
+                chunk = chunk * r.base + digit_value(*first);
+                scale *= r.base;
+            }
+            limb carry = mul_add_1(result.data(), result.size(), scale, chunk);
+            if (carry != 0) {
+                result.emplace_back(carry);
+            }
+        }
+    }
+
+    // Divide and conquer: the low chunk_digits * 2^k digits and the remaining high ones are
+    // converted separately and joined as high * chunk^(2^k) + low.
+    natural parse_radix(radix const& r, char const* first, char const* last, power_list& powers) {
+        size_t length = last - first;
+        if (length <= PARSE_THRESHOLD) {
+            natural result;
+            parse_basecase(r, first, last, result);
+            return result;
+        }
+        size_t k = 0;
+        while ((size_t(r.chunk_digits) << (k + 1)) < length) {
+            ++k;
+        }
+        size_t low = size_t(r.chunk_digits) << k;
+        natural high = parse_radix(r, first, last - low, powers);
+        natural result = mul_natural(high, radix_power(r, powers, k));
+        add_natural(result, parse_radix(r, last - low, last, powers));
+        return result;
+    }
+
+    // digits [first, last) of base 2^bits packed into limbs from the lowest one, leading zero
+    // digits leave high zero limbs
+    template <typename Storage>
+    void parse_power_of_two(uint32_t bits, char const* first, char const* last, Storage& result) {
+        result.assign((static_cast<size_t>(last - first) * bits + LIMB_BITS - 1) / LIMB_BITS, 0);
+        size_t position = 0;
+        for (char const* it = last; it != first; position += bits) {
+            limb value = digit_value(*--it);
+            size_t index = position / LIMB_BITS;
+            uint32_t offset = position % LIMB_BITS;
+            result[index] |= value << offset;
+            if (offset + bits > LIMB_BITS) {
+                result[index + 1] |= value >> (LIMB_BITS - offset);
+            }
+        }
+    }
+
+    // format_basecase below for base 10 and at most FORMAT_THRESHOLD limbs: the chunks are
+    // found first, then the kernels write all but the highest one
+    char* format_decimal_basecase(limb* a, size_t n, char* last, char* first) {
+        constexpr size_t digits = decimal_radix::chunk_digits;
+        constexpr size_t lead = digits % 8; // digits before the 8-digit groups of a chunk
+        limb chunks[2 * FORMAT_THRESHOLD + 1]; // the lowest first, a chunk has over LIMB_BITS / 2 bits
+        size_t count = 0;
+        while (n != 0) {
+            double_limb carry = 0;
+            for (size_t i = n; i-- > 0;) {
+                double_limb cur = set_high(get_low(carry)) | a[i];
+                a[i] = get_low(cur / decimal_radix::chunk);
+                carry = cur % decimal_radix::chunk;
+            }
+            chunks[count++] = get_low(carry);
+            while (n != 0 && a[n - 1] == 0) {
+                --n;
+            }
+        }
+        size_t full = first != nullptr || count == 0 ? count : count - 1;
+        char* start = last - full * digits;
+        uint32_t groups[(2 * FORMAT_THRESHOLD + 1) * (digits / 8)];
+        for (size_t i = 0; i < full; ++i) {
+            limb chunk = chunks[full - 1 - i];
+            for (size_t j = digits / 8; j-- > 0; chunk /= 100000000) {
+                groups[j * full + i] = static_cast<uint32_t>(chunk % 100000000);
+            }
+            for (size_t j = lead; j-- > 0; chunk /= 10) {
+                start[i * digits + j] = static_cast<char>('0' + chunk % 10);
+            }
+        }
+        decimal_kernels const& kernels = get_decimal_kernels();
+        for (size_t j = 0; j < digits / 8; ++j) {
+            kernels.format_groups(groups + j * full, full, start + lead + 8 * j, digits);
+        }
+        if (first != nullptr) {
+            std::fill(first, start, '0');
+            return first;
+        }
+        if (full != count) {
+            for (limb rest = chunks[full]; rest != 0; rest /= 10) {
+                *--start = static_cast<char>('0' + rest % 10);
+            }
+        }
+        return start;
+    }
+
+    // Writes the n limbs of a, which are destroyed, as digits ending at last by repeated short
+    // division by the chunk and returns the first digit. The digits are padded with zeros down
+    // to first, or have no leading zeros if first is null.
+    char* format_basecase(radix const& r, limb* a, size_t n, char* last, char* first) {
+        if (r.base == decimal_radix::base) {
+            return format_decimal_basecase(a, n, last, first);
+        }
+        while (n != 0) {
+            double_limb carry = 0;
+            for (size_t i = n; i-- > 0;) {
+                double_limb cur = set_high(get_low(carry)) | a[i];
+                a[i] = get_low(cur / r.chunk);
+                carry = cur % r.chunk;
+            }
+            limb rest = get_low(carry);
+            while (n != 0 && a[n - 1] == 0) {
+                --n;
+            }
+            if (n != 0 || first != nullptr) {
+                for (uint32_t i = 0; i < r.chunk_digits; ++i) {
+                    *--last = DIGITS[rest % r.base];
+                    rest /= r.base;
+                }
+            } else {
+                for (; rest != 0; rest /= r.base) {
+                    *--last = DIGITS[rest % r.base];
+                }
+            }
+        }
+        if (first == nullptr) {
+            return last;
+        }
+        std::fill(first, last, '0');
+        return first;
+    }
+
+    // Writes a < chunk^(2^k) as digits ending at last and returns the first one; the digits
+    // are padded to chunk_digits * 2^k if pad is set. The value is split by chunk^(2^(k - 1))
+    // until the parts are short enough for format_basecase.
+    char* format_radix(radix const& r, natural a, size_t k, power_list& powers, char* last, bool pad) {
+        size_t count = size_t(r.chunk_digits) << k;
+        if (k == 0 || a.size() <= FORMAT_THRESHOLD) {
+            return format_basecase(r, a.data(), a.size(), last, pad ? last - count : nullptr);
+        }
+        natural q, rest;
+        div_natural(a, radix_power(r, powers, k - 1), q, rest);
+        if (!pad && q.empty()) {
+            return format_radix(r, std::move(rest), k - 1, powers, last, false);
+        }
+        format_radix(r, std::move(rest), k - 1, powers, last, true);
+        return format_radix(r, std::move(q), k - 1, powers, last - count / 2, pad);
+    }
+
+    // Writes count digits of base 2^bits of a from the digit with index from, lowest first,
+    // backwards from last
+    void format_power_of_two(uint32_t bits, limb const* a, size_t n, size_t from, size_t count, char* last) {
+        limb mask = (limb(1) << bits) - 1;
+        for (size_t i = 0, position = from * bits; i < count; ++i, position += bits) {
+            size_t index = position / LIMB_BITS;
+            uint32_t offset = position % LIMB_BITS;
+            limb value = a[index] >> offset;
+            if (offset + bits > LIMB_BITS && index + 1 < n) {
+                value |= a[index + 1] << (LIMB_BITS - offset);
+            }
+            *--last = DIGITS[value & mask];
+        }
+    }
+
+    // Digits read one at a time are parsed in blocks of about PARSE_THRESHOLD, which are merged
+    // like a binary counter: the stack holds values of block_digits * 2^level digits with
+    // decreasing levels, so the work matches parse_radix without keeping the digits.
+    class radix_reader {
+    public:
+        explicit radix_reader(uint32_t base) : r(base), bits(base_bits(base)), level(0), length(0) {
+            while ((size_t(r.chunk_digits) << level) < PARSE_THRESHOLD) {
+                ++level;
+            }
+        }
+
+        void push(char digit) {
+            block[length++] = digit;
+            if (length == (size_t(r.chunk_digits) << level)) {
+                natural value = parse(block, block + length);
+                length = 0;
+                size_t value_level = level;
+                for (; !stack.empty() && stack.back().second == value_level; ++value_level) {
+                    value = join(stack.back().first, value, size_t(r.chunk_digits) << value_level, value_level);
+                    stack.pop_back();
+                }
+                stack.emplace_back(std::move(value), value_level);
+            }
+        }
+
+        natural finish() {
+            natural result;
+            for (std::pair<natural, size_t>& part : stack) {
+                result = join(result, part.first, size_t(r.chunk_digits) << part.second, part.second);
+            }
+            return join(result, parse(block, block + length), length, SIZE_MAX);
+        }
+
+    private:
+        radix r;
+        uint32_t bits;
+        size_t level; // of a full block
+        char block[2 * PARSE_THRESHOLD];
+        size_t length;
+        std::vector<std::pair<natural, size_t>> stack;
+        power_list powers;
+
+        natural parse(char const* first, char const* last) {
+            if (bits == 0) {
+                return parse_radix(r, first, last, powers);
+            }
+            natural result;
+            parse_power_of_two(bits, first, last, result);
+            trim_natural(result);
+            return result;
+        }
+
+        // high * base^digits + low, digits = chunk_digits * 2^power_level unless power_level
+        // is SIZE_MAX
+        natural join(natural const& high, natural const& low, size_t digits, size_t power_level) {
+            if (high.empty()) {
+                return low;
+            }
+            natural result;
+            if (bits != 0) {
+                result = shift_left_natural(high, digits * bits);
+            } else if (power_level != SIZE_MAX) {
+                result = mul_natural(high, radix_power(r, powers, power_level));
+            } else {
+                natural power(1, 1);
+                for (size_t i = 0; i < digits; i += r.chunk_digits) {
+                    limb scale = r.chunk;
+                    if (digits - i < r.chunk_digits) {
+                        for (scale = 1; i < digits; ++i) {
+                            scale *= r.base;
+                        }
+                    }
+                    limb carry = mul_add_1(power.data(), power.size(), scale, 0);
+                    if (carry != 0) {
+                        power.push_back(carry);
+                    }
+                }
+                result = mul_natural(high, power);
+            }
+            add_natural(result, low);
+            return result;
+        }
+    };
+
+    // Sink of operator<< writing to the stream buffer, a failed write stops the following ones
+    class stream_writer {
+    public:
+        stream_writer(std::streambuf* buffer, bool uppercase) : buffer(buffer), uppercase(uppercase), failed(false) {}
+
+        void write(char* first, char* last) {
+            if (uppercase) {
+                std::transform(first, last, first, [](char c) { return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c; });
+            }
+            std::streamsize count = last - first;
+            failed = failed || buffer->sputn(first, count) != count;
+        }
+
+        void fill(char c, size_t count) {
+            char chunk[64];
+            std::fill(chunk, chunk + sizeof(chunk), c);
+            for (; count != 0 && !failed; count -= std::min(count, sizeof(chunk))) {
+                write(chunk, chunk + std::min(count, sizeof(chunk)));
+            }
+        }
+
+        bool fail() const {
+            return failed;
+        }
+
+    private:
+        std::streambuf* buffer;
+        bool uppercase;
+        bool failed;
+    };
+
+    // format_radix writing the digits from the highest one instead of into a buffer
+    void write_radix(radix const& r, natural a, size_t k, power_list& powers, bool pad, stream_writer& out) {
+        size_t count = size_t(r.chunk_digits) << k;
+        if (k == 0 || a.size() <= FORMAT_THRESHOLD) {
+            char buffer[FORMAT_THRESHOLD * LIMB_BITS]; // digits of FORMAT_THRESHOLD limbs in base 3 and above
+            char* last = buffer + sizeof(buffer);
+            char* first = format_basecase(r, a.data(), a.size(), last, nullptr);
+            if (pad) {
+                out.fill('0', count - (last - first));
+            }
+            out.write(first, last);
+            return;
+        }
+        natural q, rest;
+        div_natural(a, radix_power(r, powers, k - 1), q, rest);
+        if (pad || !q.empty()) {
+            write_radix(r, std::move(q), k - 1, powers, pad, out);
+            pad = true;
+        }
+        write_radix(r, std::move(rest), k - 1, powers, pad, out);
+    }
+
+    void write_power_of_two(uint32_t bits, limb const* a, size_t n, size_t count, stream_writer& out) {
+        char buffer[1024];
+        for (size_t end = count; end != 0;) {
+            size_t begin = end - std::min(end, sizeof(buffer));
+            format_power_of_two(bits, a, n, begin, end - begin, buffer + (end - begin));
+            out.write(buffer, buffer + (end - begin));
+            end = begin;
+        }
+    }
+
+    void check_byte_layout(big_integer_byte_layout const& layout, size_t size) {
+        if (layout.word_size == 0 || size % layout.word_size != 0) {
+            throw std::invalid_argument("Invalid byte layout");
+        }
+    }
+
+    // Calls visit(index, offset) for the bytes of an encoding of size bytes from the lowest
+    // one: index is the significance of the byte, offset its place in the encoding.
+    template <typename Visitor>
+    void for_each_byte(big_integer_byte_layout const& layout, size_t size, Visitor visit) {
+        size_t words = size / layout.word_size;
+        bool big_words = layout.word_order == big_integer_byte_layout::big_endian;
+        bool big_bytes = layout.byte_order == big_integer_byte_layout::big_endian;
+        for (size_t word = 0, index = 0; word < words; ++word) {
+            size_t first = (big_words ? words - 1 - word : word) * layout.word_size;
+            for (size_t byte = 0; byte < layout.word_size; ++byte, ++index) {
+                visit(index, first + (big_bytes ? layout.word_size - 1 - byte : byte));
+            }
+        }
+    }
+
+    // serialized magnitudes are in 64-bit words whatever the limb width
+    constexpr size_t WORD_LIMBS = 64 / LIMB_BITS;
+    constexpr size_t SMALL_BITS = 62;
+
+    // the zigzag encoded value shifted left by one if it has at most SMALL_BITS bits,
+    // otherwise the number of words, the sign and a set lowest bit
+    uint64_t serialized_header(limb const* a, size_t n, size_t bits, bool negative) {
+        if (bits <= SMALL_BITS) {
+            uint64_t magnitude = 0;
+            for (size_t i = 0; i < n; ++i) {
+                magnitude |= static_cast<uint64_t>(a[i]) << (i * LIMB_BITS);
+            }
+            return (negative ? 2 * magnitude - 1 : 2 * magnitude) << 1;
+        }
+        return static_cast<uint64_t>((bits + 63) / 64) << 2 | static_cast<uint64_t>(negative) << 1 | 1;
+    }
+
+    size_t varint_size(uint64_t value) {
+        size_t size = 1;
+        for (; value >= 0x80; value >>= 7) {
+            ++size;
+        }
+        return size;
+    }
+}
+
+big_integer::big_integer() {}
+
+big_integer::big_integer(int value) : big_integer(static_cast<long long>(value)) {}
+
+big_integer::big_integer(unsigned int value) : big_integer(static_cast<unsigned long long>(value)) {}
+
+big_integer::big_integer(long value) : big_integer(static_cast<long long>(value)) {}
+
+big_integer::big_integer(unsigned long value) : big_integer(static_cast<unsigned long long>(value)) {}
+
+big_integer::big_integer(long long value)
+        : big_integer(value < 0 ? 0 - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value)) {
+    negative = value < 0;
+}
+
+big_integer::big_integer(unsigned long long value) {
+    for (; value != 0; value = get_high(value)) {
+        digits.emplace_back(get_low(value));
+    }
+}
+
+big_integer::big_integer(std::string const& str) : big_integer(str, 10) {}
+
+big_integer::big_integer(std::string const& str, int base) {
+    char const* last = str.data() + str.size();
+    big_integer_from_chars_result result = from_chars(str.data(), last, *this, base);
+    if (result.ec != std::errc() || result.ptr != last) {
+        throw std::invalid_argument("Invalid number");
+    }
+}
+
+big_integer::big_integer(big_integer_view const& view) {
+    digits.assign(view.data(), view.data() + view.size);
+    negative = view.negative;
+}
+
+limb big_integer::div_big_short(const limb divider) {
+    double_limb carry = 0;
+    for (size_t i = digits.size(); i-- > 0;) {
+        double_limb tmp = set_high(carry) | digits[i];
+        if (divider != 0) {
+            digits[i] = get_low(tmp / divider);
+            carry = tmp % divider;
+        } else {
+            digits[i] = LIMB_MAX;
+        }
+    }
+    trim();
+    return get_low(carry);
+}
+
+std::pair<big_integer, big_integer> big_integer::div(big_integer const& rhs) const {
+    if (compare_magnitudes(digits.data(), digits.size(), rhs.digits.data(), rhs.digits.size()) < 0) {
+        return std::make_pair(0, *this);
+    } else if (rhs.digits.size() <= 1) {
+        big_integer quotient = *this;
+        quotient.negative = negative ^ rhs.negative;
+        big_integer rest = quotient.div_big_short(rhs.digits.empty() ? 0 : rhs.digits[0]);
+        if (negative) {
+            rest.negate();
+        }
+        return std::make_pair(quotient, rest);
+    }
+    natural a = magnitude();
+    natural b = rhs.magnitude();
+    natural q, r;
+    div_natural(a, b, q, r);
+    return std::make_pair(from_magnitude(q, negative ^ rhs.negative), from_magnitude(r, negative));
+}
+
+std::vector<limb> big_integer::magnitude() const {
+    return std::vector<limb>(digits.begin(), digits.end());
+}
+
+big_integer big_integer::from_magnitude(std::vector<limb> const& magnitude, bool negative) {
+    big_integer result;
+    result.digits.assign(magnitude.begin(), magnitude.end());
+    result.negative = negative;
+    result.trim();
+    return result;
+}
+
+void big_integer::trim() {
+    while (!digits.empty() && digits.back() == 0) {
+        digits.pop_back();
+    }
+    if (digits.empty()) {
+        negative = false;
+    }
+}
+
+size_t big_integer::bit_length() const {
+    return digits.empty() ? 0 : digits.size() * LIMB_BITS - leading_zeros(digits.back());
+}
+
+bool big_integer::get_sign() const {
+    return negative;
+}
+
+void big_integer::add(big_integer_view const& rhs, bool subtract) {
+    limb const* b = rhs.data();
+    size_t n = digits.size();
+    size_t m = rhs.size;
+    bool rhs_negative = rhs.negative ^ subtract;
+    if (negative == rhs_negative) {
+        if (b == digits.data()) {
+            // a view of this would not survive the resize
+            *this <<= 1;
+            return;
+        }
+        digits.resize(std::max(n, m) + 1, 0);
+        add_in(digits.data(), digits.size(), b, m);
+    } else if (compare_magnitudes(digits.data(), n, b, m) >= 0) {
+        sub_in(digits.data(), n, b, m);
+    } else {
+        digit_storage result;
+        result.assign(b, b + m);
+        sub_in(result.data(), m, digits.data(), n);
+        digits = std::move(result);
+        negative = rhs_negative;
+    }
+    trim();
+}
+
+big_integer& big_integer::operator+=(big_integer const& rhs) {
+    add(rhs, false);
+    return *this;
+}
+
+big_integer& big_integer::operator-=(big_integer const& rhs) {
+    add(rhs, true);
+    return *this;
+}
+
+// Both operands are taken in two's complement, one limb wider than the longer magnitude
+// so that the sign of the result is kept in its top limb.
+template <typename Operation>
+void big_integer::iterate(big_integer const& rhs, Operation f) {
+    if (this == &rhs) {
+        big_integer copy = rhs;
+        iterate(copy, f);
+        return;
+    }
+    size_t m = rhs.digits.size();
+    size_t n = std::max(digits.size(), m) + 1;
+    digits.resize(n, 0);
+    if (negative) {
+        negate_n(digits.data(), n);
+    }
+    size_t i = 0;
+    if (rhs.negative) {
+        for (; rhs.digits[i] == 0; ++i) {
+            digits[i] = f(digits[i], 0);
+        }
+        digits[i] = f(digits[i], 0 - rhs.digits[i]);
+        for (++i; i < m; ++i) {
+            digits[i] = f(digits[i], ~rhs.digits[i]);
+        }
+    } else {
+        for (; i < m; ++i) {
+            digits[i] = f(digits[i], rhs.digits[i]);
+        }
+    }
+    limb rhs_fill = rhs.negative ? LIMB_MAX : 0;
+    for (; i < n; ++i) {
+        digits[i] = f(digits[i], rhs_fill);
+    }
+    negative = get_highest_bit(digits.back());
+    if (negative) {
+        negate_n(digits.data(), n);
+    }
+    trim();
+}
+
+big_integer big_integer::abs() const {
+    big_integer result = *this;
+    result.negative = false;
+    return result;
+}
+
+big_integer& big_integer::operator*=(big_integer const& rhs) {
+    return *this *= big_integer_view(rhs);
+}
+
+big_integer& big_integer::operator*=(big_integer_view const& rhs) {
+    limb const* b = rhs.data();
+    size_t n = digits.size();
+    size_t m = rhs.size;
+    bool result_negative = negative ^ rhs.negative;
+    if (n == 0 || m == 0) {
+        digits.clear();
+        negative = false;
+        return *this;
+    }
+    digit_storage res(n + m, 0);
+    if (b == digits.data() || (n == m && std::equal(digits.begin(), digits.end(), b))) {
+        sqr_unsigned(res.data(), digits.data(), n);
+    } else {
+        mul_unsigned(res.data(), digits.data(), n, b, m);
+    }
+    digits = std::move(res);
+    negative = result_negative;
+    trim();
+    return *this;
+}
+
+big_integer& big_integer::operator/=(big_integer const& rhs) {
+    return *this = div(rhs).first;
+}
+
+big_integer& big_integer::operator%=(big_integer const& rhs) {
+    return *this = div(rhs).second;
+}
+
+big_integer& big_integer::operator&=(big_integer const& rhs) {
+    iterate(rhs, [](limb lhs, limb rhs) {return lhs & rhs;});
+    return *this;
+}
+
+big_integer& big_integer::operator|=(big_integer const& rhs) {
+    iterate(rhs, [](limb lhs, limb rhs) {return lhs | rhs;});
+    return *this;
+}
+
+big_integer& big_integer::operator^=(big_integer const& rhs) {
+    iterate(rhs, [](limb lhs, limb rhs) {return lhs ^ rhs;});
+    return *this;
+}
+
+big_integer& big_integer::operator+=(big_integer_view const& rhs) {
+    add(rhs, false);
+    return *this;
+}
+
+big_integer& big_integer::operator-=(big_integer_view const& rhs) {
+    add(rhs, true);
+    return *this;
+}
+
+// division and the bitwise operations work on a copy of the view
+big_integer& big_integer::operator/=(big_integer_view const& rhs) {
+    return *this /= big_integer(rhs);
+}
+
+big_integer& big_integer::operator%=(big_integer_view const& rhs) {
+    return *this %= big_integer(rhs);
+}
+
+big_integer& big_integer::operator&=(big_integer_view const& rhs) {
+    return *this &= big_integer(rhs);
+}
+
+big_integer& big_integer::operator|=(big_integer_view const& rhs) {
+    return *this |= big_integer(rhs);
+}
+
+big_integer& big_integer::operator^=(big_integer_view const& rhs) {
+    return *this ^= big_integer(rhs);
+}
+
+big_integer& big_integer::operator<<=(int val) {
+    if (val > 0 && !digits.empty()) {
+        size_t total = val / LIMB_BITS;
+        uint32_t r = val % LIMB_BITS;
+        size_t n = digits.size();
+        digits.resize(n + total + 1, 0);
+        for (size_t i = n; i-- > 0;) {
+            double_limb cur = static_cast<double_limb>(digits[i]) << r;
+            digits[i + total + 1] |= get_high(cur);
+            digits[i + total] = get_low(cur);
+        }
+        std::fill(digits.begin(), digits.begin() + total, 0);
+        trim();
+    }
+    return *this;
+}
+
+// the shift rounds towards negative infinity like the one of a two's complement number,
+// so the magnitude of a negative value is rounded up when a set bit is shifted out
+big_integer& big_integer::operator>>=(int val) {
+    if (val > 0 && !digits.empty()) {
+        size_t total = val / LIMB_BITS;
+        uint32_t r = val % LIMB_BITS;
+        size_t n = digits.size();
+        bool round_up = false;
+        if (negative) {
+            for (size_t i = 0; i < std::min(total, n) && !round_up; ++i) {
+                round_up = digits[i] != 0;
+            }
+            if (total < n && (digits[total] & ((limb(1) << r) - 1)) != 0) {
+                round_up = true;
+            }
+        }
+        if (total >= n) {
+            digits.clear();
+        } else {
+            for (size_t i = 0; i + total < n; ++i) {
+                double_limb cur = static_cast<double_limb>(digits[i + total]) |
+                                  (i + total + 1 < n ? set_high(digits[i + total + 1]) : 0);
+                digits[i] = get_low(cur >> r);
+            }
+            digits.resize(n - total);
+        }
+        if (round_up) {
+            limb one = 1;
+            digits.emplace_back(0);
+            add_in(digits.data(), digits.size(), &one, 1);
+        }
+        trim();
+    }
+    return *this;
+}
+
+big_integer big_integer::operator+() const {
+    return *this;
+}
+
+big_integer big_integer::operator-() const& {
+    big_integer result = *this;
+    result.negate();
+    return result;
+}
+
+big_integer big_integer::operator-() && {
+    negate();
+    return std::move(*this);
+}
+
+// ~x = -x - 1
+void big_integer::invert() {
+    limb one = 1;
+    if (negative) {
+        sub_in(digits.data(), digits.size(), &one, 1);
+        negative = false;
+    } else {
+        digits.emplace_back(0);
+        add_in(digits.data(), digits.size(), &one, 1);
+        negative = true;
+    }
+    trim();
+}
+
+void big_integer::negate() {
+    if (!digits.empty()) {
+        negative = !negative;
+    }
+}
+
+big_integer big_integer::operator~() const& {
+    big_integer tmp = *this;
+    tmp.invert();
+    return tmp;
+}
+
+big_integer big_integer::operator~() && {
+    invert();
+    return std::move(*this);
+}
+
+big_integer& big_integer::operator++() {
+    return *this += 1;
+}
+
+big_integer big_integer::operator++(int) {
+    big_integer res = *this;
+    *this += 1;
+    return res;
+}
+
+big_integer& big_integer::operator--() {
+    return *this -= 1;
+}
+
+big_integer big_integer::operator--(int) {
+    big_integer res = *this;
+    *this -= 1;
+    return res;
+}
+
+big_integer operator+(big_integer lhs, big_integer const& rhs) {
+    lhs += rhs;
+    return lhs;
+}
+
+big_integer operator-(big_integer lhs, big_integer const& rhs) {
+    lhs -= rhs;
+    return lhs;
+}
+
+big_integer operator*(big_integer lhs, big_integer const& rhs) {
+    lhs *= rhs;
+    return lhs;
+}
+
+std::pair<big_integer, big_integer> divmod(big_integer const& lhs, big_integer const& rhs) {
+    return lhs.div(rhs);
+}
+
+void divmod(big_integer const& lhs, big_integer const& rhs, big_integer& quotient, big_integer& remainder) {
+    std::pair<big_integer, big_integer> result = lhs.div(rhs);
+    quotient = std::move(result.first);
+    remainder = std::move(result.second);
+}
+
+big_integer square(big_integer lhs) {
+    lhs *= lhs;
+    return lhs;
+}
+
+big_integer operator/(big_integer lhs, big_integer const& rhs) {
+    lhs /= rhs;
+    return lhs;
+}
+
+big_integer operator%(big_integer lhs, big_integer const& rhs) {
+    lhs %= rhs;
+    return lhs;
+}
+
+big_integer operator&(big_integer lhs, big_integer const& rhs) {
+    lhs &= rhs;
+    return lhs;
+}
+
+big_integer operator|(big_integer lhs, big_integer const& rhs) {
+    lhs |= rhs;
+    return lhs;
+}
+
+big_integer operator^(big_integer lhs, big_integer const& rhs) {
+    lhs ^= rhs;
+    return lhs;
+}
 
-constexpr static const uint32_t UINT32_BITS = 32;
-constexpr static const uint32_t BASE_DIVIDER = 1000000000;
-constexpr static const uint32_t STRING_STEP = 9;
-constexpr static const uint32_t HIGHEST_BIT = 1 << (UINT32_BITS - 1);
-constexpr static const std::array<uint32_t, 9> POW = {10, 100, 1000,
-                                                      10000,100000, 1000000,
-                                                      10000000, 100000000, 1000000000};
+big_integer operator<<(big_integer lhs, int rhs) {
+    lhs <<= rhs;
+    return lhs;
+}
 
-uint32_t get_low(uint64_t num) {
-    return static_cast<uint32_t>(num & UINT32_MAX);
+big_integer operator>>(big_integer lhs, int rhs) {
+    lhs >>= rhs;
+    return lhs;
 }
 
-uint32_t get_high(uint64_t num) {
-    return static_cast<uint32_t>((num >> UINT32_BITS) & UINT32_MAX);
+big_integer operator+(big_integer const& lhs, big_integer&& rhs) {
+    rhs += lhs;
+    return std::move(rhs);
 }
 
-uint64_t set_high(uint32_t num) {
-    return static_cast<uint64_t>(num) << UINT32_BITS;
+big_integer operator-(big_integer const& lhs, big_integer&& rhs) {
+    // lhs - rhs = -(rhs - lhs), which stays correct when lhs is rhs
+    rhs -= lhs;
+    rhs.negate();
+    return std::move(rhs);
 }
 
-bool get_highest_bit(uint32_t number) {
-    return number & HIGHEST_BIT;
+big_integer operator*(big_integer const& lhs, big_integer&& rhs) {
+    rhs *= lhs;
+    return std::move(rhs);
 }
 
-big_integer::big_integer() : digits(1, 0) {}
+big_integer operator&(big_integer const& lhs, big_integer&& rhs) {
+    rhs &= lhs;
+    return std::move(rhs);
+}
 
-big_integer::big_integer(int value) : digits(1, static_cast<uint32_t>(value)) {}
+big_integer operator|(big_integer const& lhs, big_integer&& rhs) {
+    rhs |= lhs;
+    return std::move(rhs);
+}
 
-big_integer::big_integer(unsigned int value) : digits(1, static_cast<uint32_t>(value)) {
-    if (get_highest_bit(value)) {
-        digits.emplace_back(0);
-    }
+big_integer operator^(big_integer const& lhs, big_integer&& rhs) {
+    rhs ^= lhs;
+    return std::move(rhs);
 }
 
-big_integer::big_integer(long value) {
-    digits.emplace_back(get_low(static_cast<uint64_t>(value)));
-    digits.emplace_back(get_high(static_cast<uint64_t>(value)));
-    trim();
+bool operator==(big_integer const& lhs, big_integer const& rhs) {
+    return lhs.negative == rhs.negative && lhs.digits == rhs.digits;
 }
 
-big_integer::big_integer(unsigned long value) {
-    digits.emplace_back(get_low(static_cast<uint64_t>(value)));
-    digits.emplace_back(get_high(static_cast<uint64_t>(value)));
-    if (get_highest_bit(digits[1])) {
-        digits.emplace_back(0);
+bool operator!=(big_integer const& lhs, big_integer const& rhs) {
+    return !(lhs == rhs);
+}
+
+bool operator<(big_integer const& lhs, big_integer const& rhs) {
+    if (lhs.negative != rhs.negative) {
+        return lhs.negative;
     }
-    trim();
+    int cmp = compare_magnitudes(lhs.digits.data(), lhs.digits.size(), rhs.digits.data(), rhs.digits.size());
+    return lhs.negative ? cmp > 0 : cmp < 0;
 }
 
-big_integer::big_integer(long long value) {
-    digits.emplace_back(get_low(static_cast<uint64_t>(value)));
-    digits.emplace_back(get_high(static_cast<uint64_t>(value)));
-    trim();
+bool operator>(big_integer const& lhs, big_integer const& rhs) {
+    return rhs < lhs;
 }
 
-big_integer::big_integer(unsigned long long value) {
-    digits.emplace_back(get_low(static_cast<uint64_t>(value)));
-    digits.emplace_back(get_high(static_cast<uint64_t>(value)));
-    if (get_highest_bit(digits[1])) {
-        digits.emplace_back(0);
-    }
-    trim();
+bool operator<=(big_integer const& lhs, big_integer const& rhs) {
+    return !(rhs < lhs);
 }
 
-big_integer::big_integer(std::string const& str) {
-    if (str.empty()) {
-        throw std::invalid_argument("Invalid number");
-    }
-    size_t start = 0;
-    if (str[0] == '-') {
-        ++start;
-    }
-    if (str.size() - start == 0) {
-        throw std::invalid_argument("Invalid number");
-    }
-    std::string tmp;
-    for (size_t i = start; i < str.size(); ++i) {
-        if (!std::isdigit(static_cast<int>(str[i]))) {
-            throw std::invalid_argument("Invalid number");
-        }
-        tmp += str[i];
-        if (tmp.size() == STRING_STEP || i == str.size() - 1) {
-            uint32_t pw = POW[tmp.size() - 1];
-            *this *= pw;
-            *this += std::stol(tmp);
-            tmp.clear();
-        }
-    }
-    if (get_highest_bit(digits.back())) {
-        digits.emplace_back(0);
-    }
-    if (str[0] == '-' && *this != 0) {
-        negate();
-    }
+bool operator>=(big_integer const& lhs, big_integer const& rhs) {
+    return !(lhs < rhs);
 }
 
-void loop_with_carry(size_t n,
-                     uint32_t carry,
-                     std::function<uint32_t (uint32_t)> const& f,
-                     std::function<size_t (uint32_t)> const& get_first,
-                     std::function<size_t (uint32_t)> const& get_second,
-                     std::function<void (size_t, uint32_t)> const& writer) {
-    for(size_t i = 0; i < n; ++i) {
-        uint64_t sum = static_cast<uint64_t>(get_first(i)) + static_cast<uint64_t>(f(get_second(i)))
-                       + static_cast<uint64_t>(carry);
-        writer(i, get_low(sum));
-        carry = get_high(sum);
+big_integer_view::big_integer_view(big_integer const& value)
+        : limbs(value.digits.data()), size(value.digits.size()), negative(value.negative) {}
+
+big_integer_view::big_integer_view(limb const* limbs, size_t size, bool negative) : limbs(limbs), size(size) {
+    while (this->size != 0 && limbs[this->size - 1] == 0) {
+        --this->size;
     }
+    this->negative = negative && this->size != 0;
 }
 
-int64_t big_integer::div_big_short(const uint32_t divider,
-                                   const bool sign_div,
-                                   const bool sign_mod) {
-    uint64_t carry = 0;
-    for (size_t i = length(); i-- > 0;) {
-        uint64_t tmp = set_high(carry) | digits[i];
-        if (divider != 0) {
-            digits[i] = get_low(tmp / divider);
-            carry = tmp % divider;
-        } else {
-            digits[i] = UINT32_MAX;
-        }
-    }
-    if (sign_div) {
-        negate();
+big_integer_view::big_integer_view(uint64_t magnitude, bool negative) : limbs(nullptr), size(0) {
+    for (; magnitude != 0; magnitude = get_high(magnitude)) {
+        small[size++] = get_low(magnitude);
     }
-    trim();
-    return static_cast<int64_t>(sign_mod ? -carry : carry);
+    this->negative = negative && size != 0;
 }
 
-bool big_integer::shift_compare(big_integer const & rhs, size_t shift) {
-    if (rhs.length() + shift != length()) {
-        return rhs.length() + shift < length();
-    }
-    for (size_t i = rhs.length(); i-- > 0;) {
-        if (digits[i + shift] != rhs.digits[i]) {
-            return digits[i + shift] > rhs.digits[i];
-        }
-    }
-    return true;
+limb const* big_integer_view::data() const {
+    return limbs != nullptr ? limbs : small;
 }
 
-void big_integer::shift_sub(std::vector<uint32_t> const& rhs, size_t shift) {
-    uint64_t carry = 0;
-    digits.resize(std::max(rhs.size(), digits.size()) + shift, 0);
-    for (size_t i = 0; i < rhs.size(); ++i) {
-        uint64_t cur = static_cast<uint64_t>(digits[i + shift]) - rhs[i] - carry;
-        digits[i + shift] = static_cast<uint32_t>(cur);
-        carry = get_highest_bit(get_high(cur));
-    }
-    for (size_t i = rhs.size() + shift; i < length() && carry; ++i) {
-        carry = (digits[i]-- == 0);
-    }
+bool operator==(big_integer_view const& lhs, big_integer_view const& rhs) {
+    return lhs.negative == rhs.negative && lhs.size == rhs.size &&
+           std::equal(lhs.data(), lhs.data() + lhs.size, rhs.data());
 }
 
-uint64_t big_integer::get_significant_digit() {
-    if (digits.size() != 1 && digits[digits.size() - 1] == 0) {
-        digits.pop_back();
-    }
-    return digits.back();
+bool operator!=(big_integer_view const& lhs, big_integer_view const& rhs) {
+    return !(lhs == rhs);
 }
 
-void big_integer::sub_div_result(big_integer const& divider, uint32_t rest, size_t shift) {
-    std::vector<uint32_t> result = std::vector<uint32_t>(divider.length() + 1, 0);
-    uint64_t carry = 0;
-    for (size_t i = 0; i < divider.length(); ++i) {
-        uint64_t cur = static_cast<uint64_t>(divider.digits[i]) * rest + carry;
-        result[i] = static_cast<uint32_t>(cur);
-        carry = get_high(cur);
+bool operator<(big_integer_view const& lhs, big_integer_view const& rhs) {
+    if (lhs.negative != rhs.negative) {
+        return lhs.negative;
     }
-    result[result.size() - 1] = static_cast<uint32_t>(carry);
-    shift_sub(result, shift);
+    int cmp = compare_magnitudes(lhs.data(), lhs.size, rhs.data(), rhs.size);
+    return lhs.negative ? cmp > 0 : cmp < 0;
 }
 
-std::pair<big_integer, big_integer> big_integer::div(big_integer const& rhs) const {
-    big_integer result = abs();
-    big_integer divider = rhs.abs();
-    if (result < divider) {
-        return std::make_pair(0, *this);
-    } else if (divider.length() == 1) {
-        int64_t rest = result.div_big_short(divider.digits[0], get_sign() ^ rhs.get_sign(), get_sign());
-        return std::make_pair(result, rest);
-    }
-    int norm = __builtin_clz(divider.get_significant_digit());
-    result <<= norm;
-    divider <<= norm;
-    uint64_t divider_high = divider.get_significant_digit();
-    size_t n = divider.length();
-    size_t m = result.length() - divider.length();
-    big_integer rest(0);
-    rest.digits.resize(m + 1, 0);
-    if (result.shift_compare(divider, m)) {
-        rest.digits[m] = 1;
-        result.shift_sub(divider.digits, m);
-    }
-    for (size_t i = m; i-- > 0;) {
-        uint64_t tmp = (set_high(result.get(n + i)) + result.get(n + i - 1)) / divider_high;
-        rest.digits[i] = static_cast<uint32_t>(tmp <= UINT32_MAX ? tmp : UINT32_MAX);
-        result.sub_div_result(divider, rest.digits[i], i);
-        size_t divider_len = divider.length();
-        while (result.get_sign()) {
-            result.digits.resize(result.digits.size() + 1, UINT32_MAX);
-            --rest.digits[i];
-            loop_with_carry(
-                result.length() - i, 0, [](uint32_t e) { return e; },
-                [&result, i](size_t j) { return result.get(i + j); },
-                [&divider, divider_len](size_t j)
-                { return static_cast<uint64_t>(j < divider_len ? divider.digits[j] : 0); },
-                [&result, i](size_t j, uint32_t val) mutable { result.digits[j + i] = val; });
-            result.trim();
-        }
-    }
-    rest.trim();
-    if (get_sign() ^ rhs.get_sign()) {
-        rest.negate();
-    }
-    result >>= norm;
-    if (get_sign()) {
-        result.negate();
-    }
-    return std::make_pair(rest, result);
-}
-
-uint32_t big_integer::get(size_t index) const {
-    return (index < digits.size()) ? digits[index] : (get_sign() ? UINT32_MAX : 0);
-}
-
-size_t big_integer::length() const {
-    return digits.size();
+bool operator>(big_integer_view const& lhs, big_integer_view const& rhs) {
+    return rhs < lhs;
 }
 
-void big_integer::trim() {
-    bool cur_sign = get_highest_bit(digits.back());
-    while (length() > 1) {
-        if (digits.back() == (cur_sign ? UINT32_MAX : 0) &&
-            get_highest_bit(digits[digits.size() - 2]) == cur_sign) {
-            digits.pop_back();
-        } else {
-            break;
-        }
-    }
+bool operator<=(big_integer_view const& lhs, big_integer_view const& rhs) {
+    return !(rhs < lhs);
 }
 
-bool big_integer::get_sign() const {
-    return !digits.empty() && get_highest_bit(digits.back());
-}
-
-void big_integer::add(big_integer const& rhs, uint32_t carry, std::function<uint32_t (uint32_t)> const& f) {
-    size_t n = std::max(length(), rhs.length()) + 2;
-    digits.resize(n, get_sign() ? UINT32_MAX : 0);
-    loop_with_carry(
-        n,
-        carry,
-        f,
-        [&, this](size_t i) { return get(i); },
-        [&, rhs](size_t i) { return rhs.get(i); },
-        [&, this](size_t i, uint32_t val) { digits[i] = val; });
-    trim();
+bool operator>=(big_integer_view const& lhs, big_integer_view const& rhs) {
+    return !(lhs < rhs);
 }
 
-big_integer& big_integer::operator+=(big_integer const& rhs) {
-    add(rhs, 0, [](uint32_t e) {return e;});
-    return *this;
+big_integer operator+(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result += rhs;
+    return result;
 }
 
-big_integer& big_integer::operator-=(big_integer const& rhs) {
-    add(rhs, 1, [](uint32_t e) {return ~e;});
-    return *this;
+big_integer operator-(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result -= rhs;
+    return result;
 }
 
-void big_integer::iterate(const big_integer& rhs, std::function<uint32_t(uint32_t, uint32_t)>const& f) {
-    size_t n = std::max(length(), rhs.length()) + 1;
-    digits.resize(n, get_sign() ? UINT32_MAX : 0);
-    for(size_t i = 0; i < n; ++i) {
-        digits[i] = f(get(i), rhs.get(i));
-    }
-    trim();
+big_integer operator*(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result *= rhs;
+    return result;
 }
 
-big_integer big_integer::abs() const {
-    return get_sign() ? -*this : *this;
+big_integer operator/(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result /= rhs;
+    return result;
 }
 
-big_integer& big_integer::operator*=(big_integer const& rhs) {
-    big_integer l = abs();
-    big_integer r = rhs.abs();
-    size_t n = std::max(length(), rhs.length()) << 1;
-    std::vector<uint32_t> res(n, 0);
-    for (size_t i = 0; i != length(); ++i) {
-        uint64_t carry = 0;
-        for (size_t j = 0; j != r.length(); ++j) {
-            uint64_t mul = static_cast<uint64_t>(l.get(i)) * static_cast<uint64_t>(r.get(j));
-            uint64_t t = static_cast<uint64_t>(get_low(mul)) + carry + static_cast<uint64_t>(res[i + j]);
-            res[i + j] = t;
-            carry = static_cast<uint64_t>(get_high(mul)) + static_cast<uint64_t>(get_high(t));
-        }
-        res[i + r.length()] += static_cast<uint32_t>(carry);
-    }
-    bool real_sign = get_sign() ^ rhs.get_sign();
-    digits = res;
-    trim();
-    if (real_sign) {
-        negate();
+big_integer operator%(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result %= rhs;
+    return result;
+}
+
+big_integer operator&(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result &= rhs;
+    return result;
+}
+
+big_integer operator|(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result |= rhs;
+    return result;
+}
+
+big_integer operator^(big_integer_view const& lhs, big_integer_view const& rhs) {
+    big_integer result(lhs);
+    result ^= rhs;
+    return result;
+}
+
+big_integer_divisor::big_integer_divisor(big_integer const& divisor) : divisor(divisor) {
+    if (divisor == 0) {
+        throw std::invalid_argument("Division by zero");
+    }
+    natural d = divisor.magnitude();
+    shift = leading_zeros(d.back());
+    normalized = shift_left_natural(d, shift);
+    if (normalized.size() >= BARRETT_THRESHOLD) {
+        reciprocal = reciprocal_natural(normalized);
     }
-    return *this;
 }
 
-big_integer& big_integer::operator/=(big_integer const& rhs) {
-    return *this = div(rhs).first;
+std::pair<big_integer, big_integer> big_integer_divisor::divmod(big_integer const& dividend) const {
+    natural a = shift_left_natural(dividend.magnitude(), shift);
+    size_t n = normalized.size();
+    natural q, r;
+    if (reciprocal.empty()) {
+        div_natural_basecase(a, normalized, q, r);
+    } else {
+        // long division by blocks of n limbs, each step is a Barrett reduction
+        size_t blocks = (a.size() + n - 1) / n;
+        q.assign(blocks * n, 0);
+        for (size_t i = blocks; i-- > 0;) {
+            natural qi;
+            div_barrett(join_natural(r, n, slice_natural(a, i * n, n)), normalized, reciprocal, qi, r);
+            std::copy(qi.begin(), qi.end(), q.begin() + i * n);
+        }
+        trim_natural(q);
+    }
+    bool negative = dividend.get_sign();
+    return std::make_pair(big_integer::from_magnitude(q, negative ^ divisor.get_sign()),
+                          big_integer::from_magnitude(shift_right_natural(r, shift), negative));
 }
 
-big_integer& big_integer::operator%=(big_integer const& rhs) {
-    return *this = div(rhs).second;
+void big_integer_divisor::divmod(big_integer const& dividend, big_integer& quotient, big_integer& remainder) const {
+    std::pair<big_integer, big_integer> result = divmod(dividend);
+    quotient = std::move(result.first);
+    remainder = std::move(result.second);
 }
 
-big_integer& big_integer::operator&=(big_integer const& rhs) {
-    iterate(rhs, [](uint32_t lhs, uint32_t rhs) {return lhs & rhs;});
-    return *this;
+big_integer const& big_integer_divisor::value() const {
+    return divisor;
 }
 
-big_integer& big_integer::operator|=(big_integer const& rhs) {
-    iterate(rhs, [](uint32_t lhs, uint32_t rhs) {return lhs | rhs;});
-    return *this;
+big_integer operator/(big_integer const& lhs, big_integer_divisor const& rhs) {
+    return rhs.divmod(lhs).first;
 }
 
-big_integer& big_integer::operator^=(big_integer const& rhs) {
-    iterate(rhs, [](uint32_t lhs, uint32_t rhs) {return lhs ^ rhs;});
-    return *this;
+big_integer operator%(big_integer const& lhs, big_integer_divisor const& rhs) {
+    return rhs.divmod(lhs).second;
 }
 
-big_integer& big_integer::operator<<=(int val) {
-    if (val > 0) {
-        size_t total = val / UINT32_BITS;
-        uint32_t r = val % UINT32_BITS;
-        size_t len = digits.size();
-        digits.resize(total + length() + (r == 0 ? 0 : 1) + 1, get_sign() ? UINT32_MAX: 0);
-        uint32_t carry = get(len);
-        uint64_t buf = 0;
-        for (size_t i = len; i-- > 0;) {
-            uint32_t tmp = get(i);
-            buf = static_cast<uint64_t>(tmp) | set_high(carry);
-            carry = tmp;
-            buf <<= r;
-            digits[i + total + 1] = get_high(buf);
-        }
-        digits[total] = get_low(buf);
-        for (size_t i = 0; i < total; ++i) {
-            digits[i] = 0;
+big_integer powmod(big_integer const& base, big_integer const& exponent, big_integer const& modulus) {
+    if (exponent.negative) {
+        throw std::invalid_argument("Negative exponent");
+    }
+    if (modulus.digits.empty()) {
+        throw std::invalid_argument("Division by zero");
+    }
+    natural m = modulus.magnitude();
+    natural q, b;
+    div_natural(base.magnitude(), m, q, b);
+    if (base.negative && !b.empty()) {
+        natural r = m;
+        sub_natural(r, b);
+        b = std::move(r);
+    }
+    if (m.size() == 1 && m[0] == 1) {
+        return 0;
+    }
+    if (exponent.digits.empty()) {
+        return 1;
+    }
+    limb const* e = exponent.digits.data();
+    size_t en = exponent.digits.size();
+    size_t window = window_size(exponent.bit_length());
+    if ((m[0] & 1) == 0) {
+        // Barrett reduction by a prepared divisor
+        big_integer_divisor divisor(modulus);
+        std::vector<big_integer> powers(size_t(1) << (window - 1), big_integer::from_magnitude(b, false));
+        if (window > 1) {
+            big_integer base_squared = square(powers[0]) % divisor;
+            for (size_t i = 1; i < powers.size(); ++i) {
+                powers[i] = powers[i - 1] * base_squared % divisor;
+            }
         }
-        trim();
+        big_integer x;
+        sliding_window(e, en, window, [&] { x = square(std::move(x)) % divisor; }, [&](size_t i, bool first) {
+            x = first ? powers[i] : x * powers[i] % divisor;
+        });
+        return x;
     }
-    return *this;
+    natural r2 = montgomery_r2(m);
+    natural n_inv_r = montgomery_modulus::whole_redc(m.size()) ? montgomery_inverse(m) : natural();
+    montgomery_modulus mont{m.data(), m.size(), negated_inverse(m[0]), r2.data(), n_inv_r.data()};
+    b.resize(m.size(), 0);
+    natural work(mont.pow_workspace_size(window));
+    mont.to_form(b.data(), b.data(), work.data());
+    mont.pow(b.data(), b.data(), e, en, window, work.data());
+    mont.from_form(b.data(), b.data(), work.data());
+    return big_integer::from_magnitude(b, false);
 }
 
-big_integer& big_integer::operator>>=(int val) {
-    if (val > 0) {
-        size_t total = val / UINT32_BITS;
-        uint32_t r = val % UINT32_BITS;
-        if (total >= length()) {
-            *this = big_integer(0);
-            return *this;
-        }
-        for (size_t i = total; i < length(); ++i) {
-            uint64_t buf = static_cast<uint64_t>(get(i)) | set_high(get(i + 1));
-            buf >>= r;
-            digits[i - total] = get_low(buf);
-        }
-        for (size_t i = length() - total; i < length(); ++i) {
-            digits[i] = get_sign() ? UINT32_MAX : 0;
-        }
-        trim();
+bool operator==(mod_context::residue const& lhs, mod_context::residue const& rhs) {
+    if (lhs.limbs.empty() || rhs.limbs.empty()) {
+        auto const& other = lhs.limbs.empty() ? rhs.limbs : lhs.limbs;
+        return std::all_of(other.begin(), other.end(), [](limb x) { return x == 0; });
     }
-    return *this;
+    return lhs.limbs == rhs.limbs;
 }
 
-big_integer big_integer::operator+() const {
-    return *this;
+bool operator!=(mod_context::residue const& lhs, mod_context::residue const& rhs) {
+    return !(lhs == rhs);
 }
 
-big_integer big_integer::operator-() const {
-    return big_integer(0) - *this;
+mod_context::mod_context(big_integer const& modulus) : divisor(modulus), n(modulus.magnitude()) {
+    if ((n[0] & 1) == 0) {
+        throw std::invalid_argument("Even modulus");
+    }
+    n_inv = negated_inverse(n[0]);
+    r2 = montgomery_r2(n);
+    if (montgomery_modulus::whole_redc(n.size())) {
+        n_inv_r = montgomery_inverse(n);
+    }
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    r1.resize(n.size());
+    natural work(mont.workspace_size());
+    mont.from_form(r1.data(), r2.data(), work.data());
+    zero.resize(n.size(), 0);
 }
 
-void big_integer::invert() {
-    for (uint32_t &number : digits) {
-        number ^= UINT32_MAX;
+// a default residue is zero, any other size comes from another context
+void mod_context::check(residue const& a) const {
+    if (!a.limbs.empty() && a.limbs.size() != n.size()) {
+        throw std::invalid_argument("Residue of another modulus");
     }
 }
 
-void big_integer::negate() {
-    uint64_t carry = 1;
-    for(uint32_t &number : digits) {
-        number ^= UINT32_MAX;
-        uint64_t sum = static_cast<uint64_t>(number) + static_cast<uint64_t>(carry);
-        number = get_low(sum);
-        carry = get_high(sum);
+limb const* mod_context::operand(residue const& a) const {
+    return a.limbs.empty() ? zero.data() : a.limbs.data();
+}
+
+big_integer const& mod_context::modulus() const {
+    return divisor.value();
+}
+
+mod_context::residue mod_context::to_residue(big_integer const& value) const {
+    big_integer reduced = value % divisor;
+    if (reduced.negative) {
+        reduced += modulus().abs();
     }
-    if (carry != 0) {
-        digits.emplace_back(get_sign() ? UINT32_MAX : 0);
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    residue result;
+    result.limbs.assign(reduced.digits.begin(), reduced.digits.end());
+    result.limbs.resize(n.size(), 0);
+    mont.to_form(result.limbs.data(), result.limbs.data(), modular_workspace(mont.workspace_size()));
+    return result;
+}
+
+big_integer mod_context::from_residue(residue const& a) const {
+    check(a);
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    big_integer result;
+    result.digits.resize(n.size());
+    mont.from_form(result.digits.data(), operand(a), modular_workspace(mont.workspace_size()));
+    result.trim();
+    return result;
+}
+
+mod_context::residue mod_context::one() const {
+    residue result;
+    result.limbs = r1;
+    return result;
+}
+
+// The operands are checked before the result is resized and fetched after, since they may
+// alias it.
+void mod_context::add(residue& r, residue const& a, residue const& b) const {
+    check(a);
+    check(b);
+    size_t k = n.size();
+    r.limbs.resize(k);
+    limb carry = add_n(r.limbs.data(), operand(a), operand(b), k);
+    if (carry != 0 || compare_n(r.limbs.data(), n.data(), k) >= 0) {
+        sub_n(r.limbs.data(), r.limbs.data(), n.data(), k);
     }
-    trim();
 }
 
-big_integer big_integer::operator~() const {
-    big_integer tmp = *this;
-    tmp.invert();
-    return tmp;
+void mod_context::sub(residue& r, residue const& a, residue const& b) const {
+    check(a);
+    check(b);
+    size_t k = n.size();
+    r.limbs.resize(k);
+    if (sub_n(r.limbs.data(), operand(a), operand(b), k) != 0) {
+        add_n(r.limbs.data(), r.limbs.data(), n.data(), k);
+    }
 }
 
-big_integer& big_integer::operator++() {
-    return *this += 1;
+void mod_context::mul(residue& r, residue const& a, residue const& b) const {
+    check(a);
+    check(b);
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    r.limbs.resize(n.size());
+    mont.mul(r.limbs.data(), operand(a), operand(b), modular_workspace(mont.workspace_size()));
 }
 
-big_integer big_integer::operator++(int) {
-    big_integer res = *this;
-    *this += 1;
-    return res;
+void mod_context::sqr(residue& r, residue const& a) const {
+    check(a);
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    r.limbs.resize(n.size());
+    mont.sqr(r.limbs.data(), operand(a), modular_workspace(mont.workspace_size()));
 }
 
-big_integer& big_integer::operator--() {
-    return *this -= 1;
+void mod_context::inv(residue& r, residue const& a) const {
+    r = to_residue(modinv(from_residue(a), modulus()));
 }
 
-big_integer big_integer::operator--(int) {
-    big_integer res = *this;
-    *this -= 1;
-    return res;
+void mod_context::pow(residue& r, residue const& a, big_integer const& exponent) const {
+    check(a);
+    if (exponent.negative) {
+        inv(r, a);
+        pow(r, r, exponent.abs());
+        return;
+    }
+    if (exponent.digits.empty()) {
+        r.limbs = r1;
+        return;
+    }
+    montgomery_modulus mont{n.data(), n.size(), n_inv, r2.data(), n_inv_r.data()};
+    size_t window = window_size(exponent.bit_length());
+    r.limbs.resize(n.size());
+    mont.pow(r.limbs.data(), operand(a), exponent.digits.data(), exponent.digits.size(), window,
+             modular_workspace(mont.pow_workspace_size(window)));
 }
 
-big_integer operator+(big_integer lhs, big_integer const& rhs) {
-    return lhs += rhs;
+big_integer gcd(big_integer const& a, big_integer const& b) {
+    natural x = a.magnitude();
+    natural y = b.magnitude();
+    if (compare_natural(x, y) < 0) {
+        x.swap(y);
+    }
+    return big_integer::from_magnitude(gcd_natural(std::move(x), std::move(y), nullptr), false);
 }
 
-big_integer operator-(big_integer lhs, big_integer const& rhs) {
-    return lhs -= rhs;
+big_integer xgcd(big_integer const& a, big_integer const& b, big_integer& x, big_integer& y) {
+    natural p = a.magnitude();
+    natural q = b.magnitude();
+    bool swapped = compare_natural(p, q) < 0;
+    if (swapped) {
+        p.swap(q);
+    }
+    euclid_matrix total;
+    natural g = gcd_natural(std::move(p), std::move(q), &total);
+    // (p, q) = total (g, 0), so g = det (m11 p - m01 q)
+    big_integer u = big_integer::from_magnitude(total.m[1][1], total.odd);
+    big_integer v = big_integer::from_magnitude(total.m[0][1], !total.odd);
+    if (swapped) {
+        std::swap(u, v);
+    }
+    x = a.negative ? -std::move(u) : std::move(u);
+    y = b.negative ? -std::move(v) : std::move(v);
+    return big_integer::from_magnitude(g, false);
 }
 
-big_integer operator*(big_integer lhs, big_integer const& rhs) {
-    return lhs *= rhs;
+big_integer modinv(big_integer const& a, big_integer const& modulus) {
+    if (modulus.digits.empty()) {
+        throw std::invalid_argument("Division by zero");
+    }
+    big_integer n = modulus.abs();
+    big_integer x, y;
+    if (xgcd(a % n, n, x, y) != 1) {
+        throw std::invalid_argument("Not invertible");
+    }
+    x %= n;
+    return x.negative ? x + n : x;
 }
 
-big_integer operator/(big_integer lhs, big_integer const& rhs) {
-    return lhs /= rhs;
+std::string to_string(big_integer const& lhs) {
+    return to_string(lhs, 10);
 }
 
-big_integer operator%(big_integer lhs, big_integer const& rhs) {
-    return lhs %= rhs;
+std::string to_string(big_integer const& lhs, int base) {
+    std::string result(length_upper_bound(lhs, base), '0');
+    big_integer_to_chars_result end = to_chars(&result[0], &result[0] + result.size(), lhs, base);
+    result.resize(end.ptr - result.data());
+    return result;
 }
 
-big_integer operator&(big_integer lhs, big_integer const& rhs) {
-    return lhs &= rhs;
+big_integer_from_chars_result from_chars(char const* first, char const* last, big_integer& value, int base) {
+    uint32_t radix_base = checked_base(base);
+    char const* begin = first != last && *first == '-' ? first + 1 : first;
+    char const* end = begin;
+    if (radix_base == decimal_radix::base) {
+        end = get_decimal_kernels().scan(begin, last);
+    }
+    while (end != last && digit_value(*end) < radix_base) {
+        ++end;
+    }
+    if (begin == end) {
+        return {first, std::errc::invalid_argument};
+    }
+    if (uint32_t bits = base_bits(radix_base)) {
+        parse_power_of_two(bits, begin, end, value.digits);
+    } else if (static_cast<size_t>(end - begin) <= PARSE_THRESHOLD) {
+        parse_basecase(radix(radix_base), begin, end, value.digits);
+    } else {
+        power_list powers;
+        natural magnitude = parse_radix(radix(radix_base), begin, end, powers);
+        value.digits.assign(magnitude.begin(), magnitude.end());
+    }
+    value.negative = begin != first;
+    value.trim();
+    return {end, std::errc()};
 }
 
-big_integer operator|(big_integer lhs, big_integer const& rhs) {
-    return lhs |= rhs;
+big_integer_to_chars_result to_chars(char* first, char* last, big_integer const& value, int base) {
+    uint32_t radix_base = checked_base(base);
+    size_t available = last - first;
+    if (value.digits.empty()) {
+        if (available == 0) {
+            return {last, std::errc::value_too_large};
+        }
+        *first = '0';
+        return {first + 1, std::errc()};
+    }
+    size_t sign = value.negative ? 1 : 0;
+    size_t count;
+    if (uint32_t digit_bits = base_bits(radix_base)) {
+        count = (value.bit_length() + digit_bits - 1) / digit_bits;
+        if (available < sign + count) {
+            return {last, std::errc::value_too_large};
+        }
+        format_power_of_two(digit_bits, value.digits.data(), value.digits.size(), 0, count, first + sign + count);
+    } else if (available >= length_upper_bound(value, base)) {
+        // the digits are written at the end of the buffer and moved to its start
+        radix r(radix_base);
+        char* start;
+        if (value.digits.size() <= FORMAT_THRESHOLD) {
+            limb a[FORMAT_THRESHOLD];
+            std::copy(value.digits.begin(), value.digits.end(), a);
+            start = format_basecase(r, a, value.digits.size(), last, nullptr);
+        } else {
+            size_t k = 0;
+            while ((size_t(r.chunk_digits) << k) < length_upper_bound(value, base) - sign) {
+                ++k;
+            }
+            power_list powers;
+            start = format_radix(r, value.magnitude(), k, powers, last, false);
+        }
+        count = last - start;
+        std::copy(start, last, first + sign);
+    } else {
+        // the bound is a digit or two above the length, which may still fit
+        std::string digits = to_string(value, base);
+        if (available < digits.size()) {
+            return {last, std::errc::value_too_large};
+        }
+        return {std::copy(digits.begin(), digits.end(), first), std::errc()};
+    }
+    if (value.negative) {
+        *first = '-';
+    }
+    return {first + sign + count, std::errc()};
 }
 
-big_integer operator^(big_integer lhs, big_integer const& rhs) {
-    return lhs ^= rhs;
+size_t length_upper_bound(big_integer const& value, int base) {
+    uint32_t radix_base = checked_base(base);
+    if (value.digits.empty()) {
+        return 1;
+    }
+    size_t sign = value.negative ? 1 : 0;
+    size_t bits = value.bit_length();
+    if (uint32_t digit_bits = base_bits(radix_base)) {
+        return sign + (bits + digit_bits - 1) / digit_bits;
+    }
+    // a value of b bits has at most b / log2(base) + 1 digits
+    return sign + static_cast<size_t>(static_cast<double>(bits) / std::log2(radix_base)) + 2;
 }
 
-big_integer operator<<(big_integer lhs, int rhs) {
-    return lhs <<= rhs;
+size_t decimal_length_upper_bound(big_integer const& value) {
+    return length_upper_bound(value, 10);
 }
 
-big_integer operator>>(big_integer lhs, int rhs) {
-    return lhs >>= rhs;
+size_t export_size(big_integer const& value, big_integer_byte_layout const& layout) {
+    check_byte_layout(layout, 0);
+    size_t bits = value.bit_length();
+    // -2^k takes k + 1 bits in two's complement, other values need one bit above their magnitude
+    if (value.negative && layout.sign == big_integer_byte_layout::twos_complement &&
+        std::all_of(value.digits.begin(), value.digits.end() - 1, [](limb x) { return x == 0; }) &&
+        (value.digits.back() & (value.digits.back() - 1)) == 0) {
+        --bits;
+    }
+    size_t bytes = bits / 8 + 1;
+    return (bytes + layout.word_size - 1) / layout.word_size * layout.word_size;
 }
 
-bool operator==(big_integer const& lhs, big_integer const& rhs) {
-    return lhs.get_sign() == rhs.get_sign() && lhs.digits == rhs.digits;
+void export_bytes(big_integer const& value, unsigned char* data, size_t size, big_integer_byte_layout const& layout) {
+    check_byte_layout(layout, size);
+    if (size < export_size(value, layout)) {
+        throw std::invalid_argument("Value does not fit");
+    }
+    bool complement = value.negative && layout.sign == big_integer_byte_layout::twos_complement;
+    unsigned carry = 1;
+    size_t top = 0;
+    for_each_byte(layout, size, [&](size_t index, size_t offset) {
+        size_t i = index / sizeof(limb);
+        unsigned byte = i < value.digits.size() ? (value.digits[i] >> (8 * (index % sizeof(limb)))) & 0xff : 0;
+        if (complement) {
+            byte = (~byte & 0xff) + carry;
+            carry = byte >> 8;
+        }
+        data[offset] = static_cast<unsigned char>(byte);
+        top = offset;
+    });
+    if (value.negative && layout.sign == big_integer_byte_layout::sign_magnitude) {
+        data[top] |= 0x80;
+    }
 }
 
-bool operator!=(big_integer const& lhs, big_integer const& rhs) {
-    return !(lhs == rhs);
+std::vector<unsigned char> export_bytes(big_integer const& value, big_integer_byte_layout const& layout) {
+    std::vector<unsigned char> result(export_size(value, layout));
+    export_bytes(value, result.data(), result.size(), layout);
+    return result;
 }
 
-bool operator<(big_integer const& lhs, big_integer const& rhs) {
-    if (lhs.get_sign() && !rhs.get_sign()) {
-        return true;
-    } else if (!lhs.get_sign() && rhs.get_sign()){
-        return false;
+big_integer import_bytes(unsigned char const* data, size_t size, big_integer_byte_layout const& layout) {
+    check_byte_layout(layout, size);
+    big_integer result;
+    if (size == 0) {
+        return result;
+    }
+    result.digits.assign((size + sizeof(limb) - 1) / sizeof(limb), 0);
+    for_each_byte(layout, size, [&](size_t index, size_t offset) {
+        result.digits[index / sizeof(limb)] |= static_cast<limb>(data[offset]) << (8 * (index % sizeof(limb)));
+    });
+    size_t sign_bit = 8 * size - 1;
+    result.negative = (result.digits.back() >> (sign_bit % LIMB_BITS)) & 1;
+    if (result.negative && layout.sign == big_integer_byte_layout::twos_complement) {
+        // sign extended to whole limbs
+        if ((sign_bit + 1) % LIMB_BITS != 0) {
+            result.digits.back() |= LIMB_MAX << ((sign_bit + 1) % LIMB_BITS);
+        }
+        negate_n(result.digits.data(), result.digits.size());
+    } else if (result.negative) {
+        result.digits.back() &= ~(limb(1) << (sign_bit % LIMB_BITS));
     }
-    size_t length_l = lhs.length();
-    size_t length_r = rhs.length();
-    if (lhs.digits.back() == 0 || lhs.digits.back() == UINT32_MAX) {
-        --length_l;
+    result.trim();
+    return result;
+}
+
+size_t serialized_size(big_integer const& value, size_t position) {
+    size_t bits = value.bit_length();
+    uint64_t header = serialized_header(value.digits.data(), value.digits.size(), bits, value.negative);
+    size_t end = position + varint_size(header);
+    if (bits <= SMALL_BITS) {
+        return end - position;
     }
-    if (rhs.digits.back() == 0 || rhs.digits.back() == UINT32_MAX) {
-        --length_r;
+    return (end + 7) / 8 * 8 + 8 * static_cast<size_t>(header >> 2) - position;
+}
+
+void serialize(big_integer const& value, std::vector<unsigned char>& out) {
+    size_t bits = value.bit_length();
+    uint64_t header = serialized_header(value.digits.data(), value.digits.size(), bits, value.negative);
+    for (; header >= 0x80; header >>= 7) {
+        out.push_back(static_cast<unsigned char>(header | 0x80));
     }
-    if (length_l != length_r) {
-        return length_l < length_r;
+    out.push_back(static_cast<unsigned char>(header));
+    if (bits <= SMALL_BITS) {
+        return;
     }
-    for (size_t i = length_l; i > 0; --i) {
-        if (lhs.digits[i - 1] != rhs.digits[i - 1]) {
-            return lhs.digits[i - 1] < rhs.digits[i - 1];
+    size_t start = (out.size() + 7) / 8 * 8;
+    out.resize(start + 8 * ((bits + 63) / 64), 0);
+    for (size_t i = 0; i < value.digits.size(); ++i) {
+        for (size_t byte = 0; byte < sizeof(limb); ++byte) {
+            out[start + i * sizeof(limb) + byte] = static_cast<unsigned char>(value.digits[i] >> (8 * byte));
         }
     }
-    return false;
 }
 
-bool operator>(big_integer const& lhs, big_integer const& rhs) {
-    return rhs < lhs;
+big_integer_reader::big_integer_reader(unsigned char const* data, size_t size) : data(data), size(size) {
+    if (reinterpret_cast<uintptr_t>(data) % 8 != 0) {
+        throw std::invalid_argument("Unaligned buffer");
+    }
 }
 
-bool operator<=(big_integer const& lhs, big_integer const& rhs) {
-    return !(rhs < lhs);
+bool big_integer_reader::done() const {
+    return offset == size;
 }
 
-bool operator>=(big_integer const& lhs, big_integer const& rhs) {
-    return !(lhs < rhs);
+size_t big_integer_reader::position() const {
+    return offset;
 }
 
-std::string to_string(big_integer const& lhs) {
-    std::string result;
-    big_integer p(lhs.abs());
-    while (p > 0) {
-        uint64_t rest = p.div_big_short(BASE_DIVIDER, false, false);
-        std::string tmp = std::to_string(rest);
-        std::reverse(tmp.begin(), tmp.end());
-        result += tmp;
-        if (p.digits[0] != 0) {
-            result.append(STRING_STEP - tmp.size(), '0');
+big_integer_view big_integer_reader::next() {
+    uint64_t header = 0;
+    for (uint32_t shift = 0;; shift += 7) {
+        if (offset == size || shift >= 64) {
+            throw std::invalid_argument("Invalid serialized value");
+        }
+        unsigned char byte = data[offset++];
+        header |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
         }
     }
-    if (result.empty()) {
-        result = "0";
+    if ((header & 1) == 0) {
+        uint64_t zigzag = header >> 1;
+        return (zigzag & 1) != 0 ? big_integer_view((zigzag >> 1) + 1, true) : big_integer_view(zigzag >> 1, false);
     }
-    if (lhs.get_sign()) {
-        result.push_back('-');
+    uint64_t words = header >> 2;
+    size_t start = (offset + 7) / 8 * 8;
+    if (start > size || words > (size - start) / 8) {
+        throw std::invalid_argument("Invalid serialized value");
     }
-    std::reverse(result.begin(), result.end());
-    return result;
+    offset = start + 8 * static_cast<size_t>(words);
+    size_t limbs = static_cast<size_t>(words) * WORD_LIMBS;
+    bool negative = ((header >> 1) & 1) != 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // the limbs are assembled from the little-endian bytes into storage the reader keeps
+    copies.emplace_back(limbs, 0);
+    std::vector<limb>& copy = copies.back();
+    for (size_t i = 0; i < limbs * sizeof(limb); ++i) {
+        copy[i / sizeof(limb)] |= static_cast<limb>(data[start + i]) << (i % sizeof(limb) * 8);
+    }
+    return big_integer_view(copy.data(), limbs, negative);
+#else
+    // the words are read in place on little-endian machines
+    return big_integer_view(reinterpret_cast<limb const*>(data + start), limbs, negative);
+#endif
+}
+
+void warm_up_radix_cache(size_t digits, int base) {
+    uint32_t radix_base = checked_base(base);
+    if (base_bits(radix_base) != 0) {
+        return;
+    }
+    radix r(radix_base);
+    size_t k = 0;
+    while ((size_t(r.chunk_digits) << k) < digits) {
+        ++k;
+    }
+    power_list powers;
+    radix_power(r, powers, k);
+}
+
+size_t set_radix_cache_limit(size_t bytes) {
+    radix_cache& cache = get_radix_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    size_t previous = cache.limit;
+    cache.limit = bytes;
+    // the largest powers are dropped first
+    while (cache.bytes > cache.limit) {
+        std::vector<std::shared_ptr<natural const>>* largest = nullptr;
+        for (std::vector<std::shared_ptr<natural const>>& table : cache.powers) {
+            if (!table.empty() && (largest == nullptr || table.back()->size() > largest->back()->size())) {
+                largest = &table;
+            }
+        }
+        cache.bytes -= largest->back()->size() * sizeof(limb);
+        largest->pop_back();
+    }
+    return previous;
+}
+
+size_t radix_cache_size() {
+    radix_cache& cache = get_radix_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return cache.bytes;
+}
+
+bool set_decimal_kernels(decimal_kernel_set kind) {
+    decimal_kernels const* kernels = find_decimal_kernels(kind);
+    if (kernels == nullptr) {
+        return false;
+    }
+    current_decimal_kernels().store(kernels, std::memory_order_relaxed);
+    return true;
 }
 
 std::ostream& operator<<(std::ostream& s, big_integer const& lhs) {
-    return s << to_string(lhs);
+    std::ostream::sentry sentry(s);
+    if (!sentry) {
+        return s;
+    }
+    std::ios_base::fmtflags flags = s.flags();
+    std::ios_base::fmtflags basefield = flags & std::ios_base::basefield;
+    int base = basefield == std::ios_base::hex ? 16 : basefield == std::ios_base::oct ? 8 : 10;
+    char prefix[3];
+    size_t prefix_length = 0;
+    if (lhs.negative) {
+        prefix[prefix_length++] = '-';
+    } else if (flags & std::ios_base::showpos) {
+        prefix[prefix_length++] = '+';
+    }
+    if ((flags & std::ios_base::showbase) && base != 10 && !lhs.digits.empty()) {
+        prefix[prefix_length++] = '0';
+        if (base == 16) {
+            prefix[prefix_length++] = 'x';
+        }
+    }
+    size_t width = s.width() > 0 ? static_cast<size_t>(s.width()) : 0;
+    s.width(0);
+    stream_writer out(s.rdbuf(), (flags & std::ios_base::uppercase) != 0);
+    size_t digits = length_upper_bound(lhs, base) - (lhs.negative ? 1 : 0);
+    if (lhs.digits.empty() || prefix_length + digits < width + 2) {
+        // the exact length is needed for the padding, such values are short
+        std::string text = to_string(lhs.abs(), base);
+        size_t padding = width > prefix_length + text.size() ? width - prefix_length - text.size() : 0;
+        std::ios_base::fmtflags adjust = flags & std::ios_base::adjustfield;
+        if (adjust != std::ios_base::left && adjust != std::ios_base::internal) {
+            out.fill(s.fill(), padding);
+        }
+        out.write(prefix, prefix + prefix_length);
+        if (adjust == std::ios_base::internal) {
+            out.fill(s.fill(), padding);
+        }
+        out.write(&text[0], &text[0] + text.size());
+        if (adjust == std::ios_base::left) {
+            out.fill(s.fill(), padding);
+        }
+    } else if (uint32_t bits = base_bits(static_cast<uint32_t>(base))) {
+        out.write(prefix, prefix + prefix_length);
+        write_power_of_two(bits, lhs.digits.data(), lhs.digits.size(), digits, out);
+    } else {
+        out.write(prefix, prefix + prefix_length);
+        radix r(static_cast<uint32_t>(base));
+        size_t k = 0;
+        while ((size_t(r.chunk_digits) << k) < digits) {
+            ++k;
+        }
+        power_list powers;
+        write_radix(r, lhs.magnitude(), k, powers, false, out);
+    }
+    if (out.fail()) {
+        s.setstate(std::ios_base::badbit);
+    }
+    return s;
+}
+
+std::istream& operator>>(std::istream& s, big_integer& value) {
+    std::istream::sentry sentry(s);
+    if (!sentry) {
+        return s;
+    }
+    typedef std::char_traits<char> traits;
+    std::ios_base::fmtflags basefield = s.flags() & std::ios_base::basefield;
+    uint32_t base = basefield == std::ios_base::hex ? 16 : basefield == std::ios_base::oct ? 8 : 10;
+    std::streambuf* buffer = s.rdbuf();
+    traits::int_type c = buffer->sgetc();
+    bool negative = c == '-';
+    if (c == '-' || c == '+') {
+        c = buffer->snextc();
+    }
+    bool any = false;
+    if (c == '0' && (base == 16 || basefield == 0)) {
+        // optional 0x prefix; without a basefield it selects hex and a plain leading 0 selects
+        // octal, as for the built-in types
+        any = true;
+        c = buffer->snextc();
+        if (c == 'x' || c == 'X') {
+            base = 16;
+            any = false;
+            c = buffer->snextc();
+        } else if (basefield == 0) {
+            base = 8;
+        }
+    }
+    radix_reader reader(base);
+    if (any) {
+        reader.push('0');
+    }
+    for (; c != traits::eof() && digit_value(traits::to_char_type(c)) < base; c = buffer->snextc()) {
+        reader.push(traits::to_char_type(c));
+        any = true;
+    }
+    std::ios_base::iostate state = c == traits::eof() ? std::ios_base::eofbit : std::ios_base::goodbit;
+    if (any) {
+        natural magnitude = reader.finish();
+        value.digits.assign(magnitude.begin(), magnitude.end());
+        value.negative = negative;
+        value.trim();
+    } else {
+        value = 0;
+        state |= std::ios_base::failbit;
+    }
+    s.setstate(state);
+    return s;
 }
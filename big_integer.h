@@ -1,14 +1,57 @@
 #pragma once
 
-#include <functional>
 #include <iosfwd>
 #include <string>
+#include <system_error>
 #include <vector>
 #include <iostream>
 
+#include "small_vector.h"
+
+// Width of a limb in bits, 32 or 64. The 64-bit build needs unsigned __int128, the 32-bit
+// one only 64-bit integers.
+#ifndef BIG_INTEGER_LIMB_BITS
+#define BIG_INTEGER_LIMB_BITS 32
+#endif
+
+// Results of from_chars and to_chars, as in <charconv>: ptr is past the last character read or
+// written, ec is std::errc() on success.
+struct big_integer_from_chars_result {
+    char const* ptr;
+    std::errc ec;
+};
+
+struct big_integer_to_chars_result {
+    char* ptr;
+    std::errc ec;
+};
+
+// Layout of the binary encodings of import_bytes and export_bytes: words of word_size bytes
+// in word_order, the bytes of each word in byte_order. Negative values are stored in two's
+// complement, or as the magnitude with the highest bit of the encoding set. The defaults are
+// big-endian two's complement bytes.
+struct big_integer_byte_layout {
+    enum endianness { little_endian, big_endian };
+    enum sign_encoding { twos_complement, sign_magnitude };
+
+    size_t word_size = 1;
+    endianness word_order = big_endian;
+    endianness byte_order = big_endian;
+    sign_encoding sign = twos_complement;
+};
+
+struct big_integer_view;
+
 struct big_integer {
+#if BIG_INTEGER_LIMB_BITS == 64
+    typedef uint64_t limb;
+#else
+    typedef uint32_t limb;
+#endif
+
     big_integer();
     big_integer(big_integer const& other) = default;
+    big_integer(big_integer&& other) noexcept = default;
     big_integer(int value);
     big_integer(unsigned int value);
     big_integer(long value);
@@ -16,9 +59,12 @@ struct big_integer {
     big_integer(long long value);
     big_integer(unsigned long long value);
     explicit big_integer(std::string const& str);
+    big_integer(std::string const& str, int base); // base 2 to 36, digits above 9 in either case
+    explicit big_integer(big_integer_view const& view);
     ~big_integer() = default;
 
     big_integer& operator=(big_integer const& other) = default;
+    big_integer& operator=(big_integer&& other) noexcept = default;
 
     big_integer& operator+=(big_integer const& rhs);
     big_integer& operator-=(big_integer const& rhs);
@@ -30,12 +76,23 @@ struct big_integer {
     big_integer& operator|=(big_integer const& rhs);
     big_integer& operator^=(big_integer const& rhs);
 
+    big_integer& operator+=(big_integer_view const& rhs);
+    big_integer& operator-=(big_integer_view const& rhs);
+    big_integer& operator*=(big_integer_view const& rhs);
+    big_integer& operator/=(big_integer_view const& rhs);
+    big_integer& operator%=(big_integer_view const& rhs);
+    big_integer& operator&=(big_integer_view const& rhs);
+    big_integer& operator|=(big_integer_view const& rhs);
+    big_integer& operator^=(big_integer_view const& rhs);
+
     big_integer& operator<<=(int val);
     big_integer& operator>>=(int val);
 
     big_integer operator+() const;
-    big_integer operator-() const;
-    big_integer operator~() const;
+    big_integer operator-() const&;
+    big_integer operator-() &&;
+    big_integer operator~() const&;
+    big_integer operator~() &&;
 
     big_integer& operator++();
     big_integer operator++(int);
@@ -51,32 +108,184 @@ struct big_integer {
     friend bool operator>=(big_integer const& a, big_integer const& b);
 
     friend std::string to_string(big_integer const& lhs);
+    friend std::string to_string(big_integer const& lhs, int base);
+    friend big_integer_from_chars_result from_chars(char const* first, char const* last, big_integer& value,
+                                                    int base);
+    friend big_integer_to_chars_result to_chars(char* first, char* last, big_integer const& value, int base);
+    friend size_t length_upper_bound(big_integer const& value, int base);
+    friend std::ostream& operator<<(std::ostream& s, big_integer const& lhs);
+    friend size_t export_size(big_integer const& value, big_integer_byte_layout const& layout);
+    friend void export_bytes(big_integer const& value, unsigned char* data, size_t size,
+                             big_integer_byte_layout const& layout);
+    friend big_integer import_bytes(unsigned char const* data, size_t size, big_integer_byte_layout const& layout);
+    friend std::istream& operator>>(std::istream& s, big_integer& value);
+    friend size_t serialized_size(big_integer const& value, size_t position);
+    friend void serialize(big_integer const& value, std::vector<unsigned char>& out);
+
+    friend big_integer operator-(big_integer const& a, big_integer&& b);
+
+    friend std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+    friend void divmod(big_integer const& a, big_integer const& b, big_integer& quotient, big_integer& remainder);
+    friend big_integer powmod(big_integer const& base, big_integer const& exponent, big_integer const& modulus);
+    friend big_integer gcd(big_integer const& a, big_integer const& b);
+    friend big_integer xgcd(big_integer const& a, big_integer const& b, big_integer& x, big_integer& y);
+    friend big_integer modinv(big_integer const& a, big_integer const& modulus);
 
     big_integer abs() const;
 
+    friend struct big_integer_divisor;
+    friend struct big_integer_view;
+    friend struct mod_context;
+
 private:
-    std::vector<uint32_t> digits; // 2's implementation, sign in the last vector element
-    void add(big_integer const& rhs, uint32_t carry, const std::function<uint32_t (uint32_t)>& function);
-    void iterate(big_integer const& rhs, const std::function<uint32_t (uint32_t, uint32_t)>& function);
+    typedef small_vector<limb, 4> digit_storage; // values of up to four limbs stay inline
+    // sign and magnitude, the magnitude has no high zero limbs (zero is empty and not negative);
+    // bitwise operations behave as on the infinite two's complement representation
+    digit_storage digits;
+    bool negative = false;
+    void add(big_integer_view const& rhs, bool subtract);
+    template <typename Operation>
+    void iterate(big_integer const& rhs, Operation function);
     void invert();
     void negate();
-    int64_t div_big_short(uint32_t divider, bool sign_div, bool sign_mod);
+    limb div_big_short(limb divider);
     std::pair<big_integer, big_integer> div(big_integer const& rhs) const;
-    uint32_t get(size_t index) const;
-    size_t length() const;
+    size_t bit_length() const;
     bool get_sign() const;
     void trim();
-    uint64_t get_significant_digit();
-    void sub_div_result(big_integer const& divider, uint32_t rest, size_t shift);
-    void shift_sub(std::vector<uint32_t> const& rhs, size_t shift);
-    bool shift_compare(big_integer const & rhs, size_t shift);
+    std::vector<limb> magnitude() const;
+    static big_integer from_magnitude(std::vector<limb> const& magnitude, bool negative);
+};
+
+// Divisor prepared for repeated division: the normalized absolute value and its
+// reciprocal are computed once, so every divmod costs a couple of multiplications.
+struct big_integer_divisor {
+    explicit big_integer_divisor(big_integer const& divisor);
+
+    // quotient and remainder with the same rounding as operator/ and operator%
+    std::pair<big_integer, big_integer> divmod(big_integer const& dividend) const;
+    void divmod(big_integer const& dividend, big_integer& quotient, big_integer& remainder) const;
+    big_integer const& value() const;
+
+private:
+    big_integer divisor;
+    std::vector<big_integer::limb> normalized; // |divisor| << shift, highest bit set
+    uint32_t shift;
+    std::vector<big_integer::limb> reciprocal; // floor(2^(2 * BIG_INTEGER_LIMB_BITS * normalized.size()) / normalized)
+};
+
+// Read-only value over limbs stored elsewhere, such as a memory-mapped file read by
+// big_integer_reader. Views compare and serve as operands without copying the limbs, which must
+// outlive the view; a big_integer converts to a view of its own limbs.
+struct big_integer_view {
+    big_integer_view(big_integer const& value);
+    // size limbs from lowest to highest, high zero limbs are ignored
+    big_integer_view(big_integer::limb const* limbs, size_t size, bool negative);
+
+    friend bool operator==(big_integer_view const& a, big_integer_view const& b);
+    friend bool operator<(big_integer_view const& a, big_integer_view const& b);
+
+    friend struct big_integer;
+    friend struct big_integer_reader;
+
+private:
+    big_integer::limb const* limbs; // null when the value is held in small
+    size_t size;
+    bool negative;
+    big_integer::limb small[64 / BIG_INTEGER_LIMB_BITS];
+    big_integer_view(uint64_t magnitude, bool negative);
+    big_integer::limb const* data() const;
 };
 
+bool operator==(big_integer_view const& a, big_integer_view const& b);
+bool operator!=(big_integer_view const& a, big_integer_view const& b);
+bool operator<(big_integer_view const& a, big_integer_view const& b);
+bool operator>(big_integer_view const& a, big_integer_view const& b);
+bool operator<=(big_integer_view const& a, big_integer_view const& b);
+bool operator>=(big_integer_view const& a, big_integer_view const& b);
+
+big_integer operator+(big_integer_view const& a, big_integer_view const& b);
+big_integer operator-(big_integer_view const& a, big_integer_view const& b);
+big_integer operator*(big_integer_view const& a, big_integer_view const& b);
+big_integer operator/(big_integer_view const& a, big_integer_view const& b);
+big_integer operator%(big_integer_view const& a, big_integer_view const& b);
+big_integer operator&(big_integer_view const& a, big_integer_view const& b);
+big_integer operator|(big_integer_view const& a, big_integer_view const& b);
+big_integer operator^(big_integer_view const& a, big_integer_view const& b);
+
 big_integer operator+(big_integer a, big_integer const& b);
 big_integer operator-(big_integer a, big_integer const& b);
 big_integer operator*(big_integer a, big_integer const& b);
+big_integer square(big_integer a);
 big_integer operator/(big_integer a, big_integer const& b);
 big_integer operator%(big_integer a, big_integer const& b);
+big_integer operator/(big_integer const& a, big_integer_divisor const& b);
+big_integer operator%(big_integer const& a, big_integer_divisor const& b);
+
+// quotient and remainder of a single division, rounded like operator/ and operator%
+std::pair<big_integer, big_integer> divmod(big_integer const& a, big_integer const& b);
+void divmod(big_integer const& a, big_integer const& b, big_integer& quotient, big_integer& remainder);
+
+// base^exponent modulo |modulus|, in [0, |modulus|); throws std::invalid_argument for a negative
+// exponent or a zero modulus. The exponent is scanned with a sliding window, odd moduli use
+// Montgomery multiplication and even ones the reduction of big_integer_divisor.
+big_integer powmod(big_integer const& base, big_integer const& exponent, big_integer const& modulus);
+
+// Greatest common divisor, never negative, by the binary algorithm for values of two limbs,
+// Lehmer's for longer ones and the half-gcd for thousands of bits. xgcd also sets x and y to
+// cofactors with a x + b y = gcd(a, b). modinv returns the inverse of a modulo |modulus| in
+// [0, |modulus|) and throws std::invalid_argument if there is none.
+big_integer gcd(big_integer const& a, big_integer const& b);
+big_integer xgcd(big_integer const& a, big_integer const& b, big_integer& x, big_integer& y);
+big_integer modinv(big_integer const& a, big_integer const& modulus);
+
+// Arithmetic modulo a fixed odd modulus n, whose sign is ignored, on residues kept in
+// Montgomery form. The constructor computes R^2 mod n, -n^-1 modulo the limb base and the
+// reciprocal that reduces values of any size. Once the result residue has the size of the
+// context, the operations allocate nothing below the NTT threshold, except inv, which goes
+// through modinv; the NTT allocates its transforms. A default residue is zero, residues of
+// another size throw std::invalid_argument. Results may alias the operands, and a context
+// may be shared between threads.
+struct mod_context {
+    // value modulo the modulus of the context that produced it, zero by default
+    struct residue {
+        friend bool operator==(residue const& a, residue const& b);
+        friend bool operator!=(residue const& a, residue const& b);
+
+    private:
+        friend struct mod_context;
+        std::vector<big_integer::limb> limbs;
+    };
+
+    // throws std::invalid_argument if the modulus is zero or even
+    explicit mod_context(big_integer const& modulus);
+
+    big_integer const& modulus() const;
+    residue to_residue(big_integer const& value) const;
+    big_integer from_residue(residue const& a) const; // in [0, |modulus|)
+    residue one() const;
+
+    void add(residue& r, residue const& a, residue const& b) const;
+    void sub(residue& r, residue const& a, residue const& b) const;
+    void mul(residue& r, residue const& a, residue const& b) const;
+    void sqr(residue& r, residue const& a) const;
+    // throws std::invalid_argument if a is not invertible
+    void inv(residue& r, residue const& a) const;
+    // a negative exponent raises the inverse
+    void pow(residue& r, residue const& a, big_integer const& exponent) const;
+
+private:
+    big_integer_divisor divisor;
+    std::vector<big_integer::limb> n;
+    std::vector<big_integer::limb> r2;      // R^2 mod n
+    std::vector<big_integer::limb> r1;      // R mod n, the residue of one
+    std::vector<big_integer::limb> zero;    // limbs of a default residue
+    std::vector<big_integer::limb> n_inv_r; // -n^-1 mod R, for long moduli
+    big_integer::limb n_inv;                // -n^-1 mod B
+
+    void check(residue const& a) const;
+    big_integer::limb const* operand(residue const& a) const;
+};
 
 big_integer operator&(big_integer a, big_integer const& b);
 big_integer operator|(big_integer a, big_integer const& b);
@@ -85,6 +294,14 @@ big_integer operator^(big_integer a, big_integer const& b);
 big_integer operator<<(big_integer a, int b);
 big_integer operator>>(big_integer a, int b);
 
+// overloads reusing the buffer of a temporary right operand
+big_integer operator+(big_integer const& a, big_integer&& b);
+big_integer operator-(big_integer const& a, big_integer&& b);
+big_integer operator*(big_integer const& a, big_integer&& b);
+big_integer operator&(big_integer const& a, big_integer&& b);
+big_integer operator|(big_integer const& a, big_integer&& b);
+big_integer operator^(big_integer const& a, big_integer&& b);
+
 bool operator==(big_integer const& a, big_integer const& b);
 bool operator!=(big_integer const& a, big_integer const& b);
 bool operator<(big_integer const& a, big_integer const& b);
@@ -93,4 +310,72 @@ bool operator<=(big_integer const& a, big_integer const& b);
 bool operator>=(big_integer const& a, big_integer const& b);
 
 std::string to_string(big_integer const& lhs);
+std::string to_string(big_integer const& lhs, int base); // lowercase digits above 9
+// Stream insertion and extraction in the base of std::hex, std::oct or std::dec. Insertion
+// honors showpos, showbase, uppercase, width and the adjustment, writing long values to the
+// stream buffer piece by piece; extraction accepts a sign, an optional 0x for hex, and parses
+// the digits as they are read. With no basefield set, extraction detects the base from a 0x
+// or 0 prefix like the built-in types.
 std::ostream& operator<<(std::ostream& s, big_integer const& a);
+std::istream& operator>>(std::istream& s, big_integer& a);
+
+// Conversions without an intermediate string. from_chars reads an optional '-' and the longest
+// run of digits in the base, reusing the buffer of value; on invalid_argument (no digits) value
+// is left unchanged. to_chars fails with value_too_large, leaving ptr == last, if the buffer is
+// short; values of up to a few hundred digits are written without allocating.
+big_integer_from_chars_result from_chars(char const* first, char const* last, big_integer& value, int base = 10);
+big_integer_to_chars_result to_chars(char* first, char* last, big_integer const& value, int base = 10);
+// number of characters to_chars may write, sign included, at most two above the actual length
+size_t length_upper_bound(big_integer const& value, int base);
+size_t decimal_length_upper_bound(big_integer const& value);
+
+// Binary encodings of the given layout, converted a byte at a time. export_size is the
+// smallest multiple of the word size that holds value with its sign. export_bytes fills all
+// size bytes, sign extending or zero padding the value; it and import_bytes throw
+// std::invalid_argument if size is not a multiple of the word size or the value does not fit.
+size_t export_size(big_integer const& value, big_integer_byte_layout const& layout = {});
+void export_bytes(big_integer const& value, unsigned char* data, size_t size,
+                  big_integer_byte_layout const& layout = {});
+std::vector<unsigned char> export_bytes(big_integer const& value, big_integer_byte_layout const& layout = {});
+big_integer import_bytes(unsigned char const* data, size_t size, big_integer_byte_layout const& layout = {});
+
+// Compact serialization. Every value starts with a LEB128 header h: values below 2^62 in
+// magnitude are the header alone, h = zigzag(value) << 1; larger ones have h = words << 2 |
+// sign << 1 | 1, then zero bytes up to a multiple of 8 from the start of the buffer and the
+// magnitude as words little-endian 64-bit words. serialize appends to out, taking out.size()
+// as the position. On little-endian machines a reader over an 8-byte aligned buffer returns
+// views of the magnitudes in place; on big-endian ones it copies every magnitude into limbs
+// it keeps, so views stay valid while the reader lives. It throws std::invalid_argument if
+// the buffer is not aligned or the input is truncated.
+size_t serialized_size(big_integer const& value, size_t position = 0);
+void serialize(big_integer const& value, std::vector<unsigned char>& out);
+
+struct big_integer_reader {
+    big_integer_reader(unsigned char const* data, size_t size);
+
+    bool done() const;
+    size_t position() const;
+    big_integer_view next();
+
+private:
+    unsigned char const* data;
+    size_t size;
+    size_t offset = 0;
+    std::vector<std::vector<big_integer::limb>> copies; // magnitudes on big-endian machines
+};
+
+// The radix powers used by the string constructors and to_string are shared by all threads
+// in a table that grows on demand. warm_up_radix_cache fills it for values of up to the given
+// number of digits. set_radix_cache_limit caps its size in bytes (64 MiB by default) and
+// returns the previous cap; larger powers are then recomputed by every conversion.
+// Power-of-two bases need no table.
+void warm_up_radix_cache(size_t digits, int base = 10);
+size_t set_radix_cache_limit(size_t bytes);
+size_t radix_cache_size();
+
+// Decimal conversions scan, parse and format digits with SSE2 or AVX2 kernels on x86-64,
+// chosen for the processor, and with scalar code elsewhere. set_decimal_kernels switches all
+// threads to another set, e.g. to test each of them; it returns false and keeps the current
+// set if the processor or the target lacks the requested one.
+enum class decimal_kernel_set { automatic, scalar, sse2, avx2 };
+bool set_decimal_kernels(decimal_kernel_set kind);
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+// Vector of trivially copyable elements that keeps up to N of them inline
+// and only allocates on the heap when it grows past that.
+template <typename T, size_t N>
+struct small_vector {
+    small_vector() : data_(inline_), size_(0), capacity_(N) {}
+
+    small_vector(size_t count, T value) : small_vector() {
+        resize(count, value);
+    }
+
+    small_vector(small_vector const& other) : small_vector() {
+        assign(other.begin(), other.end());
+    }
+
+    small_vector(small_vector&& other) noexcept : small_vector() {
+        steal(other);
+    }
+
+    ~small_vector() {
+        release();
+    }
+
+    small_vector& operator=(small_vector const& other) {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    small_vector& operator=(small_vector&& other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = inline_;
+            capacity_ = N;
+            steal(other);
+        }
+        return *this;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    T* data() {
+        return data_;
+    }
+
+    T const* data() const {
+        return data_;
+    }
+
+    T* begin() {
+        return data_;
+    }
+
+    T const* begin() const {
+        return data_;
+    }
+
+    T* end() {
+        return data_ + size_;
+    }
+
+    T const* end() const {
+        return data_ + size_;
+    }
+
+    T& operator[](size_t index) {
+        return data_[index];
+    }
+
+    T const& operator[](size_t index) const {
+        return data_[index];
+    }
+
+    T& back() {
+        return data_[size_ - 1];
+    }
+
+    T const& back() const {
+        return data_[size_ - 1];
+    }
+
+    void reserve(size_t count) {
+        if (count <= capacity_) {
+            return;
+        }
+        T* buffer = new T[count];
+        std::copy(data_, data_ + size_, buffer);
+        release();
+        data_ = buffer;
+        capacity_ = count;
+    }
+
+    void resize(size_t count, T value = T()) {
+        if (count > capacity_) {
+            reserve(std::max(count, 2 * capacity_));
+        }
+        if (count > size_) {
+            std::fill(data_ + size_, data_ + count, value);
+        }
+        size_ = count;
+    }
+
+    void emplace_back(T value) {
+        resize(size_ + 1, value);
+    }
+
+    void pop_back() {
+        --size_;
+    }
+
+    void clear() {
+        size_ = 0;
+    }
+
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        size_t count = static_cast<size_t>(std::distance(first, last));
+        if (count > capacity_) {
+            size_ = 0;
+            reserve(count);
+        }
+        std::copy(first, last, data_);
+        size_ = count;
+    }
+
+    void assign(size_t count, T value) {
+        size_ = 0;
+        resize(count, value);
+    }
+
+    void swap(small_vector& other) {
+        small_vector tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    friend bool operator==(small_vector const& a, small_vector const& b) {
+        return a.size_ == b.size_ && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+    friend bool operator!=(small_vector const& a, small_vector const& b) {
+        return !(a == b);
+    }
+
+private:
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+    T inline_[N];
+
+    void release() {
+        if (data_ != inline_) {
+            delete[] data_;
+        }
+    }
+
+    // takes the heap buffer of other or copies its inline elements, this must be inline and empty
+    void steal(small_vector& other) {
+        if (other.data_ != other.inline_) {
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+            other.data_ = other.inline_;
+            other.capacity_ = N;
+        } else {
+            std::copy(other.inline_, other.inline_ + other.size_, inline_);
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+};
@@ -1,8 +1,11 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <iomanip>
 #include <string>
 #include <limits>
+#include <sstream>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include "big_integer.h"
@@ -68,6 +71,65 @@ TEST(correctness, ctor_invalid_string)
     EXPECT_THROW(big_integer("++5"), std::invalid_argument);
 }
 
+TEST(correctness, copy_small_and_large)
+{
+    big_integer small = 7;
+    big_integer large = (big_integer(1) << 1000) + 7;
+    big_integer a = small;
+    a = large;
+    EXPECT_EQ(large, a);
+    a = small;
+    EXPECT_EQ(small, a);
+    EXPECT_EQ((big_integer(1) << 1000) + 7, large);
+
+    big_integer b = large;
+    b -= big_integer(1) << 1000;
+    EXPECT_EQ(small, b);
+    b <<= 1000;
+    EXPECT_EQ(large - 7 + (big_integer(6) << 1000), b);
+}
+
+TEST(correctness, limb_boundaries)
+{
+    big_integer a = (big_integer(1) << 32) * 1000000000 + 5;
+    big_integer b = (big_integer(1) << 64) * big_integer("10000000000000000000") + 7;
+    EXPECT_EQ("4294967296000000005", to_string(a));
+    EXPECT_EQ("184467440737095516160000000000000000007", to_string(b));
+    EXPECT_EQ(std::numeric_limits<unsigned long long>::max(), big_integer("18446744073709551615"));
+    EXPECT_EQ(big_integer(1) << 63, big_integer(std::numeric_limits<long long>::min()) / -1);
+    EXPECT_EQ(7, b % big_integer("18446744073709551616"));
+    EXPECT_EQ(big_integer("-10000000000000000007"), -b % big_integer("18446744073709551615"));
+}
+
+TEST(correctness, move_operations)
+{
+    big_integer large = (big_integer(1) << 1000) + 7;
+    big_integer a = large;
+    big_integer b = std::move(a);
+    EXPECT_EQ(large, b);
+    a = std::move(b);
+    EXPECT_EQ(large, a);
+
+    big_integer c = 12345;
+    big_integer d = -678;
+    EXPECT_EQ(large * c + d * large - c, large * c + large * d - c);
+    EXPECT_EQ(big_integer(11) - large * 2, 1 - (large * 2 - 10));
+    EXPECT_EQ(-(large * 2), large * -2);
+    EXPECT_EQ(~(large * 2), -(large * 2) - 1);
+    EXPECT_EQ(c - large * d, c - big_integer(large * d));
+    EXPECT_EQ(c & (large + 1), c & big_integer(large + 1));
+    EXPECT_EQ(c | (large + 1), big_integer(large + 1) | c);
+    EXPECT_EQ(c ^ (large + 1), big_integer(large + 1) ^ c);
+    EXPECT_EQ(12346, c + 1);
+    EXPECT_EQ(-12344, 1 - c);
+
+    // the moved-from operand may be the other one
+    big_integer e = large;
+    EXPECT_EQ(0, e - std::move(e));
+    e = large;
+    EXPECT_EQ(large * 2, e + std::move(e));
+}
+
 TEST(correctness, assignment_operator)
 {
     big_integer a = 4;
@@ -142,6 +204,21 @@ TEST(correctness, add_signed)
     EXPECT_TRUE(a == -15);
 }
 
+TEST(correctness, add_self)
+{
+    big_integer a("-100000000000000000000000000000000000000000");
+    a += a;
+    EXPECT_EQ(big_integer("-200000000000000000000000000000000000000000"), a);
+    a -= a;
+    EXPECT_EQ(0, a);
+
+    big_integer b("123456789012345678901234567890");
+    b &= b;
+    EXPECT_EQ(big_integer("123456789012345678901234567890"), b);
+    b ^= b;
+    EXPECT_EQ(0, b);
+}
+
 TEST(correctness, add_return_value)
 {
     big_integer a = 5;
@@ -499,6 +576,29 @@ TEST(correctness, shr_signed)
     EXPECT_EQ(-155, a);
 }
 
+TEST(correctness, shr_signed_long)
+{
+    big_integer a = -(big_integer(1) << 200);
+
+    EXPECT_EQ(-(big_integer(1) << 100), a >> 100);
+    EXPECT_EQ(-1, a >> 250);
+    EXPECT_EQ(-2, (a - 1) >> 200);
+    EXPECT_EQ(-1, big_integer(-1) >> 1000);
+}
+
+TEST(correctness, bitwise_signed_long)
+{
+    big_integer a = -(big_integer(1) << 100);
+    big_integer b = (big_integer(1) << 128) - 1;
+
+    EXPECT_EQ(b - ((big_integer(1) << 100) - 1), a & b);
+    EXPECT_EQ(-1, a | ~a);
+    EXPECT_EQ((big_integer(1) << 100) - 1, ~a);
+    EXPECT_EQ(-(big_integer(1) << 128) + (big_integer(1) << 100) - 1, (a ^ b) | (a & ~b));
+    EXPECT_EQ(a, a & a);
+    EXPECT_EQ(0, a ^ a);
+}
+
 TEST(correctness, shr_return_value)
 {
     big_integer a = 64;
@@ -600,6 +700,97 @@ TEST(correctness, mul_long_pow2)
     EXPECT_EQ(c, b * b);
 }
 
+TEST(correctness, mul_karatsuba)
+{
+    big_integer a = (big_integer(1) << 5000) - 1;
+    big_integer c = (big_integer(1) << 10000) - (big_integer(1) << 5001) + 1;
+
+    EXPECT_EQ(c, a * a);
+    EXPECT_EQ(-c, a * -a);
+    EXPECT_EQ(c, -a * -a);
+}
+
+TEST(correctness, mul_karatsuba_unbalanced)
+{
+    big_integer a = (big_integer(1) << 20000) - 1;
+    big_integer b = (big_integer(1) << 3000) + 1;
+    big_integer c = (big_integer(1) << 23000) + (big_integer(1) << 20000) - (big_integer(1) << 3000) - 1;
+
+    EXPECT_EQ(c, a * b);
+    EXPECT_EQ(c, b * a);
+}
+
+TEST(correctness, mul_karatsuba_div)
+{
+    big_integer a("123456789012345678901234567890123456789012345678901234567890");
+    big_integer b("-98765432109876543210987654321098765432109876543210");
+    for (int i = 0; i < 5; ++i)
+    {
+        a = a * a + 7;
+        b = b * b - 3;
+    }
+    EXPECT_EQ(a, a * b / b);
+    EXPECT_EQ(b, a * b / a);
+    EXPECT_EQ(0, a * b % b);
+}
+
+TEST(correctness, mul_toom)
+{
+    // Toom-3 runs from 3000 limbs up to the NTT: c with 32-bit limbs, d with 64-bit ones
+    big_integer a = (big_integer(1) << 50000) - 1;
+    big_integer b = (big_integer(1) << 120000) + 1;
+    big_integer c = (big_integer(1) << 150000) - 1;
+    big_integer d = (big_integer(1) << 400000) - 1;
+
+    EXPECT_EQ((big_integer(1) << 100000) - (big_integer(1) << 50001) + 1, a * a);
+    EXPECT_EQ((big_integer(1) << 240000) + (big_integer(1) << 120001) + 1, b * b);
+    EXPECT_EQ((big_integer(1) << 170000) - (big_integer(1) << 120000) + a, -a * -b);
+    EXPECT_EQ((big_integer(1) << 300000) - (big_integer(1) << 150001) + 1, c * c);
+    EXPECT_EQ((big_integer(1) << 300000) - 1, c * (c + 2));
+    EXPECT_EQ((big_integer(1) << 800000) - (big_integer(1) << 400001) + 1, d * d);
+    EXPECT_EQ((big_integer(1) << 800000) - 1, d * (d + 2));
+}
+
+TEST(correctness, mul_toom_div)
+{
+    big_integer a = (big_integer(1) << 110000) / 3 + 12345;
+    big_integer b = -(big_integer(1) << 100000) / 7 - 54321;
+
+    EXPECT_EQ(a, a * b / b);
+    EXPECT_EQ(b, a * b / a);
+}
+
+TEST(correctness, mul_ntt)
+{
+    big_integer a = (big_integer(1) << 400000) - 1;
+    big_integer b = (big_integer(1) << 150000) - 1;
+
+    EXPECT_EQ((big_integer(1) << 800000) - (big_integer(1) << 400001) + 1, a * a);
+    EXPECT_EQ((big_integer(1) << 400000) + b - (big_integer(1) << 550000), -a * b);
+
+    // past the NTT threshold with 64-bit limbs as well
+    big_integer c = (big_integer(1) << 1100000) - 1;
+    EXPECT_EQ((big_integer(1) << 2200000) - (big_integer(1) << 1100001) + 1, c * c);
+    EXPECT_EQ((big_integer(1) << 2200000) - 1, c * (c + 2));
+}
+
+TEST(correctness, square)
+{
+    EXPECT_EQ(0, square(0));
+    EXPECT_EQ(1, square(-1));
+    EXPECT_EQ(big_integer("4611686014132420609"), square(std::numeric_limits<int>::min() + 1));
+
+    for (int bits : {500, 5000, 50000, 150000})
+    {
+        big_integer a = -(big_integer(1) << bits) / 3 - 1;
+        big_integer b = a;
+        b *= b;
+        EXPECT_EQ(a * (a - 1) + a, square(a));
+        EXPECT_EQ(b, square(a));
+        EXPECT_EQ(a * a, square(a));
+    }
+}
+
 
 TEST(correctness, div_long)
 {
@@ -628,6 +819,84 @@ TEST(correctness, div_long_signed2)
     EXPECT_EQ(c, a / b);
 }
 
+TEST(correctness, div_burnikel_ziegler)
+{
+    big_integer b = (big_integer(1) << 20000) / 7 + 12345;
+    big_integer q = -(big_integer(1) << 50000) / 11 - 999;
+    big_integer r = b - 1;
+    big_integer a = q * b - r;
+
+    EXPECT_EQ(q, a / b);
+    EXPECT_EQ(-r, a % b);
+    EXPECT_EQ(-q, a / -b);
+    EXPECT_EQ(-r, a % -b);
+    EXPECT_EQ(b, a / q);
+}
+
+TEST(correctness, div_burnikel_ziegler_pow2)
+{
+    big_integer a = (big_integer(1) << 100000) - 1;
+    big_integer b = (big_integer(1) << 33333) - 1;
+
+    EXPECT_EQ((big_integer(1) << 66667) + (big_integer(1) << 33334) + 2, a / b);
+    EXPECT_EQ(1, a % b);
+    EXPECT_EQ(big_integer(1) << 66667, (a + 1) / (b + 1));
+    EXPECT_EQ(0, (a + 1) % (b + 1));
+}
+
+TEST(correctness, divmod)
+{
+    std::pair<big_integer, big_integer> qr = divmod(-100, 7);
+    EXPECT_EQ(-14, qr.first);
+    EXPECT_EQ(-2, qr.second);
+
+    big_integer a("-1000000000000000000000000000000000000000000000000000000000000000000000000000000000000000007");
+    big_integer b(                                                   "100000000000000000000000000000000000000");
+    big_integer q, r;
+    divmod(a, b, q, r);
+    EXPECT_EQ(a / b, q);
+    EXPECT_EQ(a % b, r);
+
+    divmod(a, b, a, b);
+    EXPECT_EQ(q, a);
+    EXPECT_EQ(r, b);
+
+    big_integer_divisor d(7);
+    d.divmod(100, q, r);
+    EXPECT_EQ(14, q);
+    EXPECT_EQ(2, r);
+}
+
+TEST(correctness, divisor)
+{
+    big_integer_divisor d(-7);
+
+    EXPECT_EQ(-7, d.value());
+    EXPECT_EQ(-14, 100 / d);
+    EXPECT_EQ(2, 100 % d);
+    EXPECT_EQ(14, -100 / d);
+    EXPECT_EQ(-2, -100 % d);
+    EXPECT_EQ(0, 0 / d);
+    EXPECT_THROW(big_integer_divisor(0), std::invalid_argument);
+}
+
+TEST(correctness, divisor_long)
+{
+    for (int bits : {100, 2000, 20000})
+    {
+        big_integer b = (big_integer(1) << bits) / 7 + 12345;
+        big_integer_divisor d(b);
+        for (int i = 1; i <= 4; ++i)
+        {
+            big_integer a = -((big_integer(1) << (bits * i)) / 11) - 999;
+            std::pair<big_integer, big_integer> qr = d.divmod(a);
+            EXPECT_EQ(a / b, qr.first);
+            EXPECT_EQ(a % b, qr.second);
+            EXPECT_EQ(a, qr.first * b + qr.second);
+        }
+    }
+}
+
 TEST(correctness, negation_long)
 {
     big_integer a( "10000000000000000000000000000000000000000000000000000");
@@ -679,6 +948,650 @@ TEST(correctness, string_conv)
     EXPECT_EQ("-2147483649", to_string(lim));
 }
 
+TEST(correctness, string_conv_long)
+{
+    big_integer power = 1;
+    for (size_t i = 0; i < 5000; ++i)
+    {
+        power *= 10;
+    }
+    std::string digits = "1" + std::string(5000, '0');
+
+    EXPECT_EQ(power, big_integer(digits));
+    EXPECT_EQ(-power, big_integer("-000" + digits));
+    EXPECT_EQ(power - 1, big_integer(std::string(5000, '9')));
+    EXPECT_EQ(power * 12345 + 678, big_integer("12345" + digits.substr(1, 4997) + "678"));
+    EXPECT_EQ(digits, to_string(big_integer(digits)));
+    EXPECT_EQ("-" + std::string(5000, '9'), to_string(1 - power));
+    EXPECT_EQ("1" + std::string(9999, '0') + "1", to_string(power * power + 1));
+}
+
+TEST(correctness, string_conv_radix)
+{
+    EXPECT_EQ(big_integer(255), big_integer("ff", 16));
+    EXPECT_EQ(big_integer(-255), big_integer("-FF", 16));
+    EXPECT_EQ(big_integer(10), big_integer("1010", 2));
+    EXPECT_EQ(big_integer(511), big_integer("777", 8));
+    EXPECT_EQ(big_integer(1295), big_integer("zz", 36));
+    EXPECT_EQ(big_integer(48), big_integer("66", 7));
+    EXPECT_EQ(big_integer(0), big_integer("-000", 16));
+
+    EXPECT_EQ("deadbeef", to_string(big_integer("3735928559"), 16));
+    EXPECT_EQ("-1010", to_string(big_integer(-10), 2));
+    EXPECT_EQ("0", to_string(big_integer(0), 3));
+    EXPECT_EQ("-zz", to_string(big_integer(-1295), 36));
+    EXPECT_EQ("1" + std::string(100, '0'), to_string(big_integer(1) << 100, 2));
+    EXPECT_EQ("1" + std::string(33, '0'), to_string(big_integer(1) << 99, 8));
+
+    EXPECT_THROW(big_integer("12", 1), std::invalid_argument);
+    EXPECT_THROW(big_integer("12", 37), std::invalid_argument);
+    EXPECT_THROW(big_integer("12", 2), std::invalid_argument);
+    EXPECT_THROW(big_integer("g", 16), std::invalid_argument);
+    EXPECT_THROW(to_string(big_integer(1), 0), std::invalid_argument);
+}
+
+TEST(correctness, string_conv_radix_long)
+{
+    big_integer a = 1;
+    for (size_t i = 0; i < 500; ++i)
+    {
+        a = a * 1000000007 + i;
+    }
+
+    for (int base = 2; base <= 36; ++base)
+    {
+        EXPECT_EQ(a, big_integer(to_string(a, base), base));
+        EXPECT_EQ(-a, big_integer(to_string(-a, base), base));
+    }
+    EXPECT_EQ(to_string(a), to_string(a, 10));
+    EXPECT_EQ("1" + std::string(3000, '0'), to_string(big_integer(1) << 12000, 16));
+    EXPECT_EQ((big_integer(1) << 12000) - 1, big_integer(std::string(3000, 'f'), 16));
+    EXPECT_EQ("-" + std::string(3000, '6'), to_string(1 - big_integer("1" + std::string(3000, '0'), 7), 7));
+}
+
+TEST(correctness, string_conv_digit_runs)
+{
+    std::string digits;
+    big_integer value = 0;
+    for (size_t length = 1; length <= 100; ++length)
+    {
+        digits += static_cast<char>('0' + length * 7 % 10);
+        value = value * 10 + length * 7 % 10;
+        EXPECT_EQ(value, big_integer(digits));
+        EXPECT_EQ(digits.substr(digits.find_first_not_of('0')), to_string(value));
+        EXPECT_EQ(std::string(length, '9'), to_string(big_integer(std::string(length, '9'))));
+    }
+
+    for (char bad : {'/', ':', ' ', '\x80', '\xff'})
+    {
+        for (size_t position = 0; position < 70; ++position)
+        {
+            std::string str(70, '5');
+            str[position] = bad;
+            big_integer a;
+            EXPECT_EQ(str.data() + position, from_chars(str.data(), str.data() + str.size(), a).ptr);
+            EXPECT_THROW(big_integer{str}, std::invalid_argument);
+        }
+    }
+}
+
+TEST(correctness, from_chars)
+{
+    std::string str = "-12345xyz";
+    big_integer a = 7;
+    big_integer_from_chars_result result = from_chars(str.data(), str.data() + str.size(), a);
+    EXPECT_EQ(std::errc(), result.ec);
+    EXPECT_EQ(str.data() + 6, result.ptr);
+    EXPECT_EQ(big_integer(-12345), a);
+
+    result = from_chars(str.data() + 6, str.data() + str.size(), a, 36);
+    EXPECT_EQ(str.data() + str.size(), result.ptr);
+    EXPECT_EQ(big_integer(44027), a);
+
+    str = "-x";
+    result = from_chars(str.data(), str.data() + str.size(), a);
+    EXPECT_EQ(std::errc::invalid_argument, result.ec);
+    EXPECT_EQ(str.data(), result.ptr);
+    EXPECT_EQ(big_integer(44027), a);
+
+    str = "-0";
+    from_chars(str.data(), str.data() + str.size(), a, 2);
+    EXPECT_EQ(big_integer(0), a);
+    EXPECT_EQ("0", to_string(-a));
+
+    str = std::string(3000, '9');
+    from_chars(str.data(), str.data() + str.size(), a);
+    EXPECT_EQ(big_integer(str), a);
+}
+
+TEST(correctness, to_chars)
+{
+    char buffer[64];
+    big_integer a("-1234567890123456789012345");
+    big_integer_to_chars_result result = to_chars(buffer, buffer + sizeof(buffer), a);
+    EXPECT_EQ(std::errc(), result.ec);
+    EXPECT_EQ("-1234567890123456789012345", std::string(buffer, result.ptr));
+
+    result = to_chars(buffer, buffer + 26, a);
+    EXPECT_EQ(std::errc(), result.ec);
+    EXPECT_EQ(buffer + 26, result.ptr);
+    result = to_chars(buffer, buffer + 25, a);
+    EXPECT_EQ(std::errc::value_too_large, result.ec);
+    EXPECT_EQ(buffer + 25, result.ptr);
+
+    result = to_chars(buffer, buffer + 1, big_integer(0), 16);
+    EXPECT_EQ("0", std::string(buffer, result.ptr));
+    result = to_chars(buffer, buffer + 3, big_integer(-255), 16);
+    EXPECT_EQ("-ff", std::string(buffer, result.ptr));
+    EXPECT_EQ(std::errc::value_too_large, to_chars(buffer, buffer + 2, big_integer(-255), 16).ec);
+    EXPECT_EQ(std::errc::value_too_large, to_chars(buffer, buffer, big_integer(0)).ec);
+
+    big_integer power = 1;
+    for (size_t i = 0; i < 100; ++i)
+    {
+        EXPECT_LE(to_string(power - 1).size(), decimal_length_upper_bound(power - 1));
+        EXPECT_LE(to_string(-power, 3).size(), length_upper_bound(-power, 3));
+        EXPECT_EQ(to_string(power, 2).size(), length_upper_bound(power, 2));
+        power *= 1000000007;
+    }
+    std::string digits(decimal_length_upper_bound(power), ' ');
+    result = to_chars(&digits[0], &digits[0] + digits.size(), power);
+    digits.resize(result.ptr - digits.data());
+    EXPECT_EQ(to_string(power), digits);
+}
+
+TEST(correctness, stream_output)
+{
+    std::ostringstream out;
+    out << big_integer(-255) << ' ' << std::hex << big_integer(-255) << ' ' << std::oct << big_integer(8);
+    EXPECT_EQ("-255 -ff 10", out.str());
+
+    out.str("");
+    out << std::showbase << std::uppercase << std::hex << big_integer(255) << ' ' << big_integer(0);
+    out << ' ' << std::dec << std::showpos << big_integer(7) << ' ' << big_integer(0);
+    EXPECT_EQ("0XFF 0 +7 +0", out.str());
+
+    out.str("");
+    out << std::noshowpos << std::setw(6) << big_integer(-42) << '|' << std::left << std::setw(6) << big_integer(-42)
+        << '|' << std::internal << std::setfill('0') << std::setw(6) << big_integer(-42) << '|' << big_integer(-42);
+    EXPECT_EQ("   -42|-42   |-00042|-42", out.str());
+
+    big_integer a = big_integer(1) << 20000;
+    a = a / 3 - a;
+    out.flags(std::ios_base::dec);
+    out.str("");
+    out << std::setw(10) << a;
+    EXPECT_EQ(to_string(a), out.str());
+    out.str("");
+    out << std::hex << a << std::oct << ' ' << a;
+    EXPECT_EQ(to_string(a, 16) + ' ' + to_string(a, 8), out.str());
+}
+
+TEST(correctness, stream_input)
+{
+    std::istringstream in("  -123 +45 0x1F ff 17 z");
+    big_integer a, b, c, d, e;
+    in >> a >> b >> std::hex >> c >> d >> std::oct >> e;
+    EXPECT_EQ(big_integer(-123), a);
+    EXPECT_EQ(big_integer(45), b);
+    EXPECT_EQ(big_integer(31), c);
+    EXPECT_EQ(big_integer(255), d);
+    EXPECT_EQ(big_integer(15), e);
+    EXPECT_TRUE(in.good());
+
+    in >> a;
+    EXPECT_TRUE(in.fail());
+    EXPECT_EQ(big_integer(0), a);
+
+    std::string digits = "-" + std::string(7000, '8') + "1234567";
+    in.clear();
+    in.str(digits);
+    in >> std::dec >> a;
+    EXPECT_TRUE(in.eof());
+    EXPECT_EQ(big_integer(digits), a);
+
+    in.clear();
+    in.str(to_string(a, 16));
+    in >> std::hex >> b;
+    EXPECT_EQ(a, b);
+}
+
+TEST(correctness, stream_input_detect_base)
+{
+    std::istringstream in("0x1F 017 42 -0X10 +0 0 08");
+    in >> std::setbase(0);
+    std::istringstream expected(in.str());
+    expected >> std::setbase(0);
+    big_integer a;
+    long long b;
+    for (int i = 0; i < 8; ++i)
+    {
+        in >> a;
+        expected >> b;
+        EXPECT_EQ(b, a);
+    }
+    EXPECT_TRUE(in.eof());
+    EXPECT_TRUE(expected.eof());
+
+    in.clear();
+    in.str("0x" + to_string((big_integer(1) << 200) - 1, 16) + " -0" + std::string(70, '7'));
+    in >> a;
+    EXPECT_EQ((big_integer(1) << 200) - 1, a);
+    in >> a;
+    EXPECT_EQ(1 - (big_integer(1) << 210), a);
+}
+
+TEST(correctness, export_bytes)
+{
+    typedef std::vector<unsigned char> bytes;
+    EXPECT_EQ(bytes({0x00}), export_bytes(0));
+    EXPECT_EQ(bytes({0xff}), export_bytes(-1));
+    EXPECT_EQ(bytes({0x80}), export_bytes(-128));
+    EXPECT_EQ(bytes({0x00, 0x80}), export_bytes(128));
+    EXPECT_EQ(bytes({0xff, 0x7f}), export_bytes(-129));
+    EXPECT_EQ(bytes({0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}), export_bytes(-(big_integer(1) << 71)));
+    EXPECT_EQ(bytes({0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}), export_bytes(-(big_integer(1) << 64)));
+
+    big_integer_byte_layout layout;
+    layout.sign = big_integer_byte_layout::sign_magnitude;
+    EXPECT_EQ(bytes({0x81}), export_bytes(-1, layout));
+    EXPECT_EQ(bytes({0x80, 0x80}), export_bytes(-128, layout));
+
+    layout = big_integer_byte_layout();
+    layout.word_size = 4;
+    layout.word_order = big_integer_byte_layout::little_endian;
+    EXPECT_EQ(bytes({0x02, 0x03, 0x04, 0x05, 0x00, 0x00, 0x00, 0x01}), export_bytes(0x0102030405LL, layout));
+    layout.byte_order = big_integer_byte_layout::little_endian;
+    EXPECT_EQ(bytes({0x05, 0x04, 0x03, 0x02, 0x01, 0x00, 0x00, 0x00}), export_bytes(0x0102030405LL, layout));
+
+    unsigned char buffer[4];
+    export_bytes(-2, buffer, sizeof(buffer));
+    EXPECT_EQ(bytes({0xff, 0xff, 0xff, 0xfe}), bytes(buffer, buffer + 4));
+    EXPECT_THROW(export_bytes(big_integer(1) << 31, buffer, sizeof(buffer)), std::invalid_argument);
+    EXPECT_THROW(export_bytes(1, buffer, 3, layout), std::invalid_argument);
+}
+
+TEST(correctness, import_bytes)
+{
+    unsigned char data[] = {0xff, 0x7f};
+    EXPECT_EQ(big_integer(-129), import_bytes(data, 2));
+    EXPECT_EQ(big_integer(-1), import_bytes(data, 1));
+    EXPECT_EQ(big_integer(0), import_bytes(data, 0));
+    big_integer_byte_layout layout;
+    layout.sign = big_integer_byte_layout::sign_magnitude;
+    EXPECT_EQ(big_integer(-0x7f7f), import_bytes(data, 2, layout));
+    layout.word_size = 2;
+    EXPECT_THROW(import_bytes(data, 1, layout), std::invalid_argument);
+
+    big_integer a = 1;
+    for (size_t i = 0; i < 40; ++i)
+    {
+        a = a * 1000000007 + i;
+    }
+    for (size_t word_size : {1, 2, 3, 8})
+    {
+        for (int order = 0; order < 4; ++order)
+        {
+            for (auto sign : {big_integer_byte_layout::twos_complement, big_integer_byte_layout::sign_magnitude})
+            {
+                layout.word_size = word_size;
+                layout.word_order = static_cast<big_integer_byte_layout::endianness>(order & 1);
+                layout.byte_order = static_cast<big_integer_byte_layout::endianness>(order >> 1);
+                layout.sign = sign;
+                for (big_integer const& value : {a, -a, -(big_integer(1) << 255), big_integer(0)})
+                {
+                    std::vector<unsigned char> encoded = export_bytes(value, layout);
+                    EXPECT_EQ(value, import_bytes(encoded.data(), encoded.size(), layout));
+                    encoded.resize(encoded.size() + 2 * word_size);
+                    export_bytes(value, encoded.data(), encoded.size(), layout);
+                    EXPECT_EQ(value, import_bytes(encoded.data(), encoded.size(), layout));
+                }
+            }
+        }
+    }
+}
+
+TEST(correctness, powmod)
+{
+    EXPECT_EQ(445, powmod(4, 13, 497));
+    EXPECT_EQ(52, powmod(-4, 13, 497));
+    EXPECT_EQ(445, powmod(4, 13, -497));
+    EXPECT_EQ(1, powmod(3, 0, 7));
+    EXPECT_EQ(0, powmod(3, 0, 1));
+    EXPECT_EQ(0, powmod(0, 5, 8));
+    EXPECT_THROW(powmod(3, -1, 7), std::invalid_argument);
+    EXPECT_THROW(powmod(3, 1, 0), std::invalid_argument);
+
+    // Fermat's little theorem for the Mersenne primes 2^127 - 1 and 2^1279 - 1
+    for (int p : {127, 1279})
+    {
+        big_integer prime = (big_integer(1) << p) - 1;
+        big_integer a("123456789123456789123456789");
+        EXPECT_EQ(1, powmod(a, prime - 1, prime));
+        EXPECT_EQ(a, powmod(a, prime, prime));
+    }
+
+    big_integer a("98765432109876543210987654321098765432109876543210");
+    for (big_integer const& m : {big_integer(1) << 200, (big_integer(1) << 200) + 1, a * a + 2, a * a + 3})
+    {
+        big_integer expected = 1;
+        for (int i = 0; i < 300; ++i)
+        {
+            expected = expected * a % m;
+            EXPECT_EQ(expected, powmod(a, i + 1, m));
+        }
+    }
+
+    // a modulus long enough for the Montgomery reduction by whole products
+    big_integer m = (big_integer(1) << 20000) + 12345;
+    big_integer x = (a << 19700) + 1;
+    big_integer e("123456789123456789");
+    big_integer expected = 1;
+    for (big_integer f = e, power = x; f != 0; f >>= 1, power = power * power % m)
+    {
+        if ((f & 1) != 0)
+        {
+            expected = expected * power % m;
+        }
+    }
+    EXPECT_EQ(expected, powmod(x, e, m));
+    EXPECT_EQ(expected, powmod(x - m, e, m));
+}
+
+TEST(correctness, gcd)
+{
+    EXPECT_EQ(6, gcd(12, 18));
+    EXPECT_EQ(6, gcd(-12, 18));
+    EXPECT_EQ(6, gcd(12, -18));
+    EXPECT_EQ(5, gcd(0, -5));
+    EXPECT_EQ(0, gcd(0, 0));
+    EXPECT_EQ(big_integer("9000000000900000000090"),
+              gcd(big_integer("123456789012345678901234567890"), big_integer("987654321098765432109876543210")));
+
+    auto power = [](big_integer base, int n) {
+        big_integer result = 1;
+        for (; n != 0; n /= 2, base *= base)
+        {
+            if (n % 2 != 0)
+            {
+                result *= base;
+            }
+        }
+        return result;
+    };
+
+    // 3^n and 5^n are coprime, the sizes reach Lehmer's algorithm and the half-gcd
+    for (int n : {10, 100, 1000, 20000, 50000})
+    {
+        big_integer p = power(3, n);
+        big_integer q = power(5, n);
+        big_integer g = power(7, n / 10);
+        big_integer a = g * p * 2;
+        big_integer b = -g * (q + 1);
+        EXPECT_EQ(1, gcd(p, q));
+        EXPECT_EQ(g * 2, gcd(a, b));
+
+        big_integer x, y;
+        EXPECT_EQ(g * 2, xgcd(a, b, x, y));
+        EXPECT_EQ(g * 2, a * x + b * y);
+        EXPECT_LE(x.abs(), b.abs());
+        EXPECT_LE(y.abs(), a.abs());
+
+        big_integer inverse = modinv(p, q);
+        EXPECT_EQ(1, p * inverse % q);
+        EXPECT_GE(inverse, 0);
+        EXPECT_LT(inverse, q);
+    }
+
+    big_integer x, y;
+    EXPECT_EQ(2, xgcd(240, -46, x, y));
+    EXPECT_EQ(2, 240 * x - 46 * y);
+    EXPECT_EQ(0, xgcd(0, 0, x, y));
+
+    EXPECT_EQ(5, modinv(3, 7));
+    EXPECT_EQ(2, modinv(-3, 7));
+    EXPECT_EQ(5, modinv(3, -7));
+    EXPECT_EQ(0, modinv(5, 1));
+    EXPECT_THROW(modinv(6, 15), std::invalid_argument);
+    EXPECT_THROW(modinv(3, 0), std::invalid_argument);
+}
+
+TEST(correctness, mod_context)
+{
+    EXPECT_THROW(mod_context(0), std::invalid_argument);
+    EXPECT_THROW(mod_context(10), std::invalid_argument);
+
+    big_integer a("98765432109876543210987654321098765432109876543210");
+    big_integer b("-12345678901234567890123456789");
+    for (big_integer const& m : {big_integer(-11), a * a + 7, (big_integer(1) << 1279) - 1, (big_integer(1) << 20000) + 1})
+    {
+        mod_context context(m);
+        big_integer n = m.abs();
+        auto reduce = [&n](big_integer x) { return (x % n + n) % n; };
+        mod_context::residue x = context.to_residue(a);
+        mod_context::residue y = context.to_residue(b);
+        mod_context::residue r;
+        EXPECT_EQ(reduce(a), context.from_residue(x));
+        EXPECT_EQ(1, context.from_residue(context.one()));
+        context.add(r, x, y);
+        EXPECT_EQ(reduce(a + b), context.from_residue(r));
+        context.sub(r, x, y);
+        EXPECT_EQ(reduce(a - b), context.from_residue(r));
+        context.sub(r, y, x);
+        EXPECT_EQ(reduce(b - a), context.from_residue(r));
+        context.mul(r, x, y);
+        EXPECT_EQ(reduce(a * b), context.from_residue(r));
+        context.sqr(r, r);
+        EXPECT_EQ(reduce(a * b * a * b), context.from_residue(r));
+        context.pow(r, x, 1000);
+        EXPECT_EQ(powmod(a, 1000, m), context.from_residue(r));
+        context.pow(r, x, 0);
+        EXPECT_TRUE(r == context.one());
+
+        context.inv(r, y);
+        context.mul(r, r, y);
+        EXPECT_TRUE(r == context.one());
+        context.pow(r, y, -3);
+        context.mul(r, r, y);
+        context.mul(r, r, y);
+        context.mul(r, r, y);
+        EXPECT_TRUE(r == context.one());
+    }
+
+    mod_context context(15);
+    mod_context::residue r;
+    EXPECT_THROW(context.inv(r, context.to_residue(6)), std::invalid_argument);
+
+    // a default residue is zero
+    mod_context::residue z;
+    EXPECT_EQ(0, context.from_residue(z));
+    EXPECT_TRUE(z == context.to_residue(0));
+    context.add(r, z, context.one());
+    EXPECT_TRUE(r == context.one());
+    context.sub(r, z, context.one());
+    EXPECT_EQ(14, context.from_residue(r));
+    context.mul(r, z, context.one());
+    EXPECT_TRUE(r == z);
+    context.pow(z, z, 5);
+    EXPECT_TRUE(z == context.to_residue(0));
+    EXPECT_THROW(context.inv(r, mod_context::residue()), std::invalid_argument);
+    mod_context wide(b);
+    EXPECT_THROW(context.add(r, context.one(), wide.one()), std::invalid_argument);
+    // also when the result aliases the foreign residue
+    mod_context::residue w = wide.to_residue(12345);
+    EXPECT_THROW(context.add(w, w, context.one()), std::invalid_argument);
+    EXPECT_THROW(context.sub(w, context.one(), w), std::invalid_argument);
+    EXPECT_THROW(context.mul(w, w, w), std::invalid_argument);
+    EXPECT_THROW(context.sqr(w, w), std::invalid_argument);
+    EXPECT_THROW(context.pow(w, w, 3), std::invalid_argument);
+    EXPECT_THROW(context.pow(w, w, 0), std::invalid_argument);
+    EXPECT_THROW(context.inv(w, w), std::invalid_argument);
+    EXPECT_EQ(12345, wide.from_residue(w));
+}
+
+TEST(correctness, serialize)
+{
+    big_integer a = 1;
+    for (size_t i = 0; i < 40; ++i)
+    {
+        a = a * 1000000007 + i;
+    }
+    big_integer small = (big_integer(1) << 62) - 1;
+    std::vector<big_integer> values = {0, 1, -1, 63, -64, small, -small, small + 1, -small - 1, a, -a, a << 32};
+    std::vector<unsigned char> out;
+    for (big_integer const& value : values)
+    {
+        size_t position = out.size();
+        size_t size = serialized_size(value, position);
+        serialize(value, out);
+        EXPECT_EQ(position + size, out.size());
+    }
+    EXPECT_EQ(1u, serialized_size(big_integer(-32)));
+    EXPECT_EQ(2u, serialized_size(big_integer(32)));
+    EXPECT_EQ(13u, serialized_size(small + 1, 3));
+
+    big_integer_reader reader(out.data(), out.size());
+    for (big_integer const& value : values)
+    {
+        ASSERT_FALSE(reader.done());
+        big_integer_view view = reader.next();
+        EXPECT_EQ(value, big_integer(view));
+        EXPECT_TRUE(view == value);
+    }
+    EXPECT_TRUE(reader.done());
+    EXPECT_EQ(out.size(), reader.position());
+
+    big_integer_reader truncated(out.data(), out.size() - 1);
+    for (size_t i = 0; i + 1 < values.size(); ++i)
+    {
+        truncated.next();
+    }
+    EXPECT_THROW(truncated.next(), std::invalid_argument);
+}
+
+TEST(correctness, big_integer_view)
+{
+    big_integer a("-123456789012345678901234567890123456789");
+    big_integer b("98765432109876543210987654321");
+    std::vector<unsigned char> out;
+    serialize(a, out);
+    serialize(b, out);
+    serialize(-7, out);
+    big_integer_reader reader(out.data(), out.size());
+    big_integer_view va = reader.next();
+    big_integer_view vb = reader.next();
+    big_integer_view vc = reader.next();
+
+    EXPECT_TRUE(va < vb);
+    EXPECT_TRUE(va < vc && vc < vb);
+    EXPECT_TRUE(vb > b - 1 && vb >= b && vb <= b && vb != a);
+    EXPECT_EQ(a + b, va + vb);
+    EXPECT_EQ(a - b, va - b);
+    EXPECT_EQ(a * b, a * vb);
+    EXPECT_EQ(a * a, va * va);
+    EXPECT_EQ(a / b, va / vb);
+    EXPECT_EQ(a % -7, va % vc);
+    EXPECT_EQ(a & b, va & vb);
+    EXPECT_EQ(a | -7, va | vc);
+    EXPECT_EQ(a ^ b, va ^ vb);
+
+    big_integer c = b;
+    c += va;
+    EXPECT_EQ(a + b, c);
+    c -= vc;
+    EXPECT_EQ(a + b + 7, c);
+    c *= vb;
+    EXPECT_EQ((a + b + 7) * b, c);
+    c = a;
+    c += big_integer_view(c);
+    EXPECT_EQ(a * 2, c);
+    c -= big_integer_view(c);
+    EXPECT_EQ(0, c);
+
+    big_integer::limb limbs[] = {5, 0, 0};
+    EXPECT_TRUE(big_integer_view(limbs, 3, true) == big_integer(-5));
+    EXPECT_TRUE(big_integer_view(limbs + 1, 2, true) == big_integer());
+}
+
+TEST(correctness, radix_cache)
+{
+    std::string digits = "7" + std::string(20000, '3');
+    size_t limit = set_radix_cache_limit(0);
+    EXPECT_EQ(0u, radix_cache_size());
+    EXPECT_EQ(digits, to_string(big_integer(digits)));
+
+    set_radix_cache_limit(limit);
+    warm_up_radix_cache(digits.size());
+    size_t warm = radix_cache_size();
+    EXPECT_GT(warm, 0u);
+    EXPECT_EQ(digits, to_string(big_integer(digits)));
+    EXPECT_EQ(warm, radix_cache_size());
+
+    std::vector<std::thread> threads;
+    std::vector<int> results(4);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        threads.emplace_back([&results, i] {
+            std::string number = std::to_string(i + 1) + std::string(5000 * (i + 1), '1');
+            results[i] = to_string(big_integer(number)) == number;
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(std::vector<int>(4, 1), results);
+}
+
+TEST(correctness, decimal_kernels)
+{
+    // digit runs around the group and register widths, and long enough for the recursive split
+    std::vector<std::string> runs;
+    for (size_t length : {1, 7, 8, 9, 15, 16, 17, 19, 20, 31, 32, 33, 63, 64, 65, 200, 1500})
+    {
+        std::string run(length, '0');
+        for (size_t i = 0; i < length; ++i)
+        {
+            run[i] = static_cast<char>('0' + (i * 7 + length) % 10);
+        }
+        run[0] = '9';
+        runs.push_back(run);
+    }
+    for (decimal_kernel_set kind : {decimal_kernel_set::scalar, decimal_kernel_set::sse2, decimal_kernel_set::avx2})
+    {
+        if (!set_decimal_kernels(kind))
+        {
+            continue;
+        }
+        for (std::string const& run : runs)
+        {
+            big_integer expected = 0;
+            for (char c : run)
+            {
+                expected = expected * 10 + (c - '0');
+            }
+            EXPECT_EQ(expected, big_integer(run));
+            EXPECT_EQ(-expected, big_integer("-" + run));
+            EXPECT_EQ(run, to_string(expected));
+            EXPECT_EQ("-" + run, to_string(-expected));
+            EXPECT_THROW(big_integer(run + "x" + run), std::invalid_argument);
+
+            std::istringstream in(run + "z");
+            big_integer value;
+            in >> value;
+            EXPECT_EQ(expected, value);
+        }
+        big_integer power = 1;
+        for (int i = 0; i < 300; ++i)
+        {
+            power *= 10;
+        }
+        EXPECT_EQ("1" + std::string(300, '0'), to_string(power));
+        EXPECT_EQ(power - 1, big_integer(std::string(300, '9')));
+    }
+    EXPECT_TRUE(set_decimal_kernels(decimal_kernel_set::automatic));
+}
+
 namespace
 {
     template <typename T>
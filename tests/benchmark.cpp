@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "../big_integer.h"
+
+namespace
+{
+    constexpr size_t TOTAL_WORDS = size_t(1) << 26;
+
+    // operands of the given number of 32-bit words, one of them negative; sizes are counted
+    // in 32-bit words so that builds with different limb widths can be compared
+    big_integer operand(size_t words, int seed)
+    {
+        big_integer result = (big_integer(1) << static_cast<int>(32 * words - 2)) / (seed + 6) + seed;
+        return seed % 2 == 0 ? result : -result;
+    }
+
+    // operations doing more than a linear pass are run proportionally fewer times, cost is
+    // roughly their work per word
+    void measure(std::string const& name, size_t words, size_t cost,
+                 std::function<void(big_integer&, big_integer const&)> const& operation)
+    {
+        big_integer a = operand(words, 1);
+        big_integer b = operand(words, 2);
+        size_t iterations = TOTAL_WORDS / words / cost + 1;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i != iterations; ++i)
+        {
+            operation(a, b);
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        std::printf("%-6s %8zu words %14.3f ns/word\n", name.c_str(), words,
+                    elapsed.count() / static_cast<double>(iterations * words));
+    }
+} // namespace
+
+int main()
+{
+    std::printf("%d-bit limbs\n", BIG_INTEGER_LIMB_BITS);
+    for (size_t words : {1, 2, 4, 64, 1024, 16384})
+    {
+        measure("+=", words, 1, [](big_integer& a, big_integer const& b) { a += b; });
+        measure("-=", words, 1, [](big_integer& a, big_integer const& b) { a -= b; });
+        measure("&=", words, 1, [](big_integer& a, big_integer const& b) { a &= b; });
+        measure("|=", words, 1, [](big_integer& a, big_integer const& b) { a |= b; });
+        measure("^=", words, 1, [](big_integer& a, big_integer const& b) { a ^= b; });
+        measure("<<", words, 1, [](big_integer& a, big_integer const& b) { a = b << 45; });
+        measure("b+b", words, 1, [](big_integer& a, big_integer const& b) { a = b + b; });
+        measure("b*b", words, 1, [](big_integer& a, big_integer const& b) { a = b * b; });
+        measure("a*b", words, 1, [](big_integer& a, big_integer const& b) { a = b * (b + 1); });
+        measure("b*b/b", words, 1, [](big_integer& a, big_integer const& b) { a = b * b / b; });
+        measure("str", words, words, [](big_integer& a, big_integer const& b) { a = big_integer(to_string(b)); });
+    }
+    // multiplication around the thresholds of Toom-3 and the NTT
+    for (size_t words : {2000, 3000, 4500, 6000, 9000, 12000, 18000, 24000, 36000})
+    {
+        measure("a*b", words, 256, [](big_integer& a, big_integer const& b) { a = b * (b + 1); });
+    }
+}
@@ -279,3 +279,16 @@ TEST(correctness_random, bit_shifts)
         EXPECT_EQ(to_string(a >> shift), to_string(R >> shift));
     }
 }
+
+TEST(correctness_random, mul_above_ntt_limit)
+{
+    // products beyond the largest NTT, split in three by Toom-Cook and, for the larger
+    // operands, in four; the pieces go back to the NTT
+    for (int bits : {150000000, 210000000})
+    {
+        big_integer a = (big_integer(1) << bits) - 1;
+        big_integer b = (big_integer(1) << bits) + 1;
+        EXPECT_EQ((big_integer(1) << (2 * bits)) - 1, a * b);
+        EXPECT_EQ((big_integer(1) << (2 * bits)) - (big_integer(1) << (bits + 1)) + 1, a * a);
+    }
+}